@@ -0,0 +1,867 @@
+/**
+ * \author       Dirk de la Hunt (gmail:noshbar)
+ * \copyright    Mozilla Public License 1.1 
+ * \version      1.0.1.0
+ * \brief        Micro benchmarks for the DWScript DLL wrapper, run it against an old and a new DLL to compare them
+ *
+ * Usage: benchmark [calls [library [results]]]\n
+ * Given a results file, every measurement is also written to it as a tab separated line of benchmark, variant, metric and value,
+ * for comparing runs over time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <Windows.h>
+#define DEFAULT_LIBRARY "..\\dwscript.dll"
+typedef HANDLE Thread;
+typedef DWORD  ThreadResult;
+#define THREAD_CALL WINAPI
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#define DEFAULT_LIBRARY "../libdwscript.so"
+typedef pthread_t Thread;
+typedef void*     ThreadResult;
+#define THREAD_CALL
+typedef int LONG;
+#define InterlockedIncrement(value) __sync_add_and_fetch(value, 1)
+#endif
+#include "dwscript.h"
+
+static char  buffer[1024];
+static FILE *results;
+
+/** returns the current time in seconds */
+static double now()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec counter;
+    clock_gettime(CLOCK_MONOTONIC, &counter);
+    return counter.tv_sec + counter.tv_nsec * 1e-9;
+#endif
+}
+
+/** writes one measurement to the results file, if there is one */
+static void record(const char *benchmark, const char *variant, const char *metric, double value)
+{
+    if (results)
+        fprintf(results, "%s\t%s\t%s\t%.6g\n", benchmark, variant, metric, value);
+}
+
+static Thread startThread(ThreadResult (THREAD_CALL *function)(void *), void *argument)
+{
+#ifdef _WIN32
+    return CreateThread(NULL, 0, function, argument, 0, NULL);
+#else
+    pthread_t thread;
+    pthread_create(&thread, NULL, function, argument);
+    return thread;
+#endif
+}
+
+static void joinThreads(Thread *threads, int count)
+{
+    int index;
+#ifdef _WIN32
+    WaitForMultipleObjects(count, threads, TRUE, INFINITE);
+    for (index = 0; index < count; index++)
+        CloseHandle(threads[index]);
+#else
+    for (index = 0; index < count; index++)
+        pthread_join(threads[index], NULL);
+#endif
+}
+
+static int processorCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO system;
+    GetSystemInfo(&system);
+    return system.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+void __stdcall add(DWScript_Data *dwsData, void *userData)
+{
+    dwsData->result.i = dwsData->parameters.value[0].i + dwsData->parameters.value[1].i;
+}
+
+void __stdcall scale(DWScript_Data *dwsData, void *userData)
+{
+    dwsData->result.f = dwsData->parameters.value[0].f * 0.5f;
+}
+
+typedef struct Item
+{
+    double price;
+    int    quantity;
+}
+Item;
+
+static double *values;
+
+void __stdcall value(DWScript_Data *dwsData, void *userData)
+{
+    dwsData->result.f = values[dwsData->parameters.value[0].i];
+}
+
+/** compiles the script into the context and executes it once, printing how many host calls per second were made */
+static void benchmarkCallbacks(DWScriptContext context, const char *name, const char *script, int calls)
+{
+    double start, elapsed;
+
+    if (!DWScript_compile(context, script, DWScript_Flags_None))
+    {
+        DWScript_getMessage(context, buffer, 1024);
+        printf("%-24s could not compile: %s\n", name, buffer);
+        return;
+    }
+
+    start = now();
+    if (!DWScript_execute(context, DWScript_Flags_None))
+    {
+        DWScript_getMessage(context, buffer, 1024);
+        printf("%-24s could not execute: %s\n", name, buffer);
+        return;
+    }
+    elapsed = now() - start;
+    printf("%-24s %10d calls in %8.3fs (%12.0f calls/s)\n", name, calls, elapsed, calls / elapsed);
+    record(name, "", "calls/s", calls / elapsed);
+}
+
+static int compareTimes(const void *a, const void *b)
+{
+    double difference = *(const double*)a - *(const double*)b;
+    return difference < 0 ? -1 : difference > 0;
+}
+
+/** runs a small compiled script over and over, reporting the median and the 99th percentile time of a single DWScript_execute() */
+static void benchmarkLatency(DWScriptContext context, int runs)
+{
+    double *times, start, total = 0;
+    int     index;
+
+    if (!DWScript_compile(context, "var i, total : integer; begin for i := 1 to 10 do total := total + i; end.", DWScript_Flags_None))
+        return;
+    times = (double*)malloc(runs * sizeof(double));
+    for (index = 0; index < runs; index++)
+    {
+        start = now();
+        DWScript_execute(context, DWScript_Flags_None);
+        times[index] = now() - start;
+        total += times[index];
+    }
+    qsort(times, runs, sizeof(double), compareTimes);
+    printf("%-24s %10d runs in %8.3fs (median %8.2fus, p99 %8.2fus)\n", "execute latency", runs, total, 1e6 * times[runs / 2], 1e6 * times[runs * 99 / 100]);
+    record("execute latency", "", "median us", 1e6 * times[runs / 2]);
+    record("execute latency", "", "p99 us", 1e6 * times[runs * 99 / 100]);
+    free(times);
+}
+
+/** runs the script again with sampling every millisecond to show what profiling costs, then prints where the samples landed */
+static void benchmarkProfiling(DWScriptContext context, const char *script, int calls)
+{
+    if (!DWScript_setProfiling(context, 1))
+        return;
+    benchmarkCallbacks(context, "callback (profiled)", script, calls);
+    DWScript_setProfiling(context, 0);
+
+    DWScript_getProfile(context, DWScript_ProfileFormat_Functions, buffer, 1024);
+    printf("samples\tcalls\tfunction\n%s", buffer);
+    DWScript_resetProfile(context);
+}
+
+/** each thread gets its own execution of the shared program, only paying for its own stack and globals */
+static ThreadResult THREAD_CALL executeThread(void *program)
+{
+    DWScriptExecution execution = DWScript_createExecution((DWScriptProgram)program);
+
+    if (execution)
+    {
+        DWScript_run(execution, DWScript_Flags_None);
+        DWScript_destroyExecution(execution);
+    }
+    return 0;
+}
+
+/** runs the one compiled program on 1, 2, 4... threads at once,
+    the calls/s should scale with the number of cores as callbacks no longer share any per-function state */
+static void benchmarkThreadedCallbacks(DWScriptProgram program, int calls, int maxThreads)
+{
+    Thread threads[64];
+    char   variant[16];
+    int    threadCount, index;
+    double start, elapsed;
+
+    for (threadCount = 1; threadCount <= maxThreads && threadCount <= 64; threadCount *= 2)
+    {
+        start = now();
+        for (index = 0; index < threadCount; index++)
+            threads[index] = startThread(executeThread, program);
+        joinThreads(threads, threadCount);
+        elapsed = now() - start;
+
+        printf("callback, %2d thread(s)   %10d calls in %8.3fs (%12.0f calls/s)\n", threadCount, calls * threadCount, elapsed, calls * threadCount / elapsed);
+        sprintf(variant, "%d threads", threadCount);
+        record("callback (threaded)", variant, "calls/s", calls * threadCount / elapsed);
+    }
+}
+
+static volatile LONG completions;
+
+void __stdcall completed(DWScriptJob job, int success, void *userData)
+{
+    if (success)
+        InterlockedIncrement(&completions);
+}
+
+/** submits the program to the worker pool over and over, one job in flight per execution, without any thread of our own */
+static void benchmarkAsync(DWScriptProgram program, int jobs, int executionCount)
+{
+    DWScriptExecution       executions[64];
+    DWScriptJob             pending[64];
+    DWScript_PoolStatistics statistics;
+    double                  start, elapsed;
+    int                     index, submitted = 0;
+
+    if (executionCount > 64)
+        executionCount = 64;
+    for (index = 0; index < executionCount; index++)
+    {
+        executions[index] = DWScript_createExecution(program);
+        pending[index]    = NULL;
+    }
+
+    completions = 0;
+    start = now();
+    while (submitted < jobs)
+    {
+        for (index = 0; index < executionCount && submitted < jobs; index++)
+        {
+            if (pending[index])
+                DWScript_destroyJob(pending[index]); //waits for it, the others keep the pool busy meanwhile
+            pending[index] = DWScript_runAsync(executions[index], 0, completed, NULL);
+            submitted++;
+        }
+    }
+    for (index = 0; index < executionCount; index++)
+        DWScript_destroyJob(pending[index]);
+    elapsed = now() - start;
+    printf("%-24s %10d jobs in %8.3fs (%12.0f jobs/s, %d completed)\n", "RunAsync", jobs, elapsed, jobs / elapsed, (int)completions);
+    record("RunAsync", "", "jobs/s", jobs / elapsed);
+    if (DWScript_getPoolStatistics(&statistics))
+        printf("%-24s %d workers, %d busy, %d queued (peak %d), %d submitted, %d completed, %d cancelled\n", "worker pool", statistics.workers, statistics.busy, statistics.queued, statistics.peakQueued, statistics.submitted, statistics.completed, statistics.cancelled);
+
+    for (index = 0; index < executionCount; index++)
+        DWScript_destroyExecution(executions[index]);
+}
+
+/** calls a small script function repeatedly, through DWScript_callStateless(), a persistent session, and batches within that session */
+static void benchmarkScriptCalls(DWScriptContext context, int calls)
+{
+    static const char *script =
+        "function Square(value : integer) : integer;\n"
+        "begin\n"
+        "  result := value * value;\n"
+        "end;\n"
+        "begin end.";
+    DWScript_Data      data;
+    DWScriptProgram    program;
+    DWScriptExecution  execution;
+    DWScriptCallable   callable;
+    DWScript_Column    column, results;
+    double             start, elapsed;
+    int                index, batch, batchSize = 1024;
+
+    memset(&data, 0, sizeof(data));
+    data.parameters.count = 1;
+    data.parameters.value[0].datatype = DWScript_DataType_Integer;
+
+    if (!DWScript_compile(context, script, DWScript_Flags_None))
+        return;
+    start = now();
+    for (index = 0; index < calls; index++)
+    {
+        data.parameters.value[0].i = index & 0xFF;
+        if (!DWScript_callStateless(context, "Square", &data))
+            break;
+    }
+    elapsed = now() - start;
+    printf("%-24s %10d calls in %8.3fs (%12.0f calls/s)\n", "CallStateless", index, elapsed, index / elapsed);
+    record("CallStateless", "", "calls/s", index / elapsed);
+
+    program = DWScript_createProgram(context, script, DWScript_Flags_None);
+    if (!program)
+        return;
+    execution = DWScript_createExecution(program);
+    if (execution && DWScript_beginExecution(execution, DWScript_Flags_None))
+    {
+        callable = DWScript_findFunction(execution, "Square");
+        start = now();
+        for (index = 0; callable && index < calls; index++)
+        {
+            data.parameters.value[0].i = index & 0xFF;
+            if (!DWScript_invoke(callable, &data))
+                break;
+        }
+        elapsed = now() - start;
+        printf("%-24s %10d calls in %8.3fs (%12.0f calls/s)\n", "Invoke (session)", index, elapsed, index / elapsed);
+        record("Invoke (session)", "", "calls/s", index / elapsed);
+
+        column.datatype  = DWScript_DataType_Integer;
+        column.i         = (long long*)malloc(batchSize * sizeof(long long));
+        results.datatype = DWScript_DataType_Integer;
+        results.i        = (long long*)malloc(batchSize * sizeof(long long));
+        for (index = 0; index < batchSize; index++)
+            column.i[index] = index & 0xFF;
+        start = now();
+        for (index = 0, batch = 0; callable && index < calls; index += batchSize, batch++)
+        {
+            if (!DWScript_invokeBatch(callable, &column, 1, batchSize, &results))
+                break;
+        }
+        elapsed = now() - start;
+        printf("%-24s %10d rows in %8.3fs (%12.0f rows/s, %d batches of %d)\n", "InvokeBatch (session)", index, elapsed, index / elapsed, batch, batchSize);
+        record("InvokeBatch (session)", "", "rows/s", index / elapsed);
+        free(column.i);
+        free(results.i);
+        DWScript_endExecution(execution);
+    }
+    DWScript_destroyExecution(execution);
+    DWScript_destroyProgram(program);
+}
+
+void __stdcall echo(DWScript_Data *dwsData, void *userData)
+{
+    dwsData->result.u = dwsData->parameters.value[0].u;
+}
+
+/** passes the same text into a script function and back out of it, then through a callback and back, reporting the bytes crossing the boundary per second */
+static void benchmarkStrings(DWScriptContext context, const char *name, const char *text, int calls)
+{
+    static const char *script =
+        "function Identity(s : String) : String;\n"
+        "begin\n"
+        "  result := s;\n"
+        "end;\n"
+        "function EchoLoop(s : String; count : Integer) : Integer;\n"
+        "var i : integer;\n"
+        "begin\n"
+        "  for i := 1 to count do\n"
+        "    result := result + Length(Echo(s));\n"
+        "end;\n"
+        "begin end.";
+    DWScript_Data      data;
+    DWScriptProgram    program;
+    DWScriptExecution  execution;
+    DWScriptCallable   identity, loop;
+    double             start, elapsed;
+    int                index, length = (int)strlen(text);
+
+    program = DWScript_createProgram(context, script, DWScript_Flags_None);
+    if (!program)
+        return;
+    execution = DWScript_createExecution(program);
+    if (execution && DWScript_beginExecution(execution, DWScript_Flags_None))
+    {
+        identity = DWScript_findFunction(execution, "Identity");
+        loop     = DWScript_findFunction(execution, "EchoLoop");
+        memset(&data, 0, sizeof(data));
+        data.parameters.count = 1;
+
+        data.parameters.value[0].datatype = DWScript_DataType_String;
+        data.parameters.value[0].s = (char*)text;
+        start = now();
+        for (index = 0; identity && index < calls; index++)
+            if (!DWScript_invoke(identity, &data))
+                break;
+        elapsed = now() - start;
+        printf("%-24s %-9s %10d calls in %8.3fs (%8.1f MB/s in and out)\n", "String invoke", name, index, elapsed, 2.0 * length * index / (1024.0 * 1024.0) / elapsed);
+        record("String invoke", name, "MB/s", 2.0 * length * index / (1024.0 * 1024.0) / elapsed);
+
+        data.parameters.value[0].datatype = DWScript_DataType_UTF8;
+        data.parameters.value[0].u.text   = text;
+        data.parameters.value[0].u.length = length;
+        data.result.datatype              = DWScript_DataType_UTF8;
+        start = now();
+        for (index = 0; identity && index < calls; index++)
+            if (!DWScript_invoke(identity, &data))
+                break;
+        elapsed = now() - start;
+        printf("%-24s %-9s %10d calls in %8.3fs (%8.1f MB/s in and out%s)\n", "UTF8 invoke", name, index, elapsed, 2.0 * length * index / (1024.0 * 1024.0) / elapsed,
+            data.result.u.length == length && !memcmp(data.result.u.text, text, length) ? "" : ", MISMATCH");
+        record("UTF8 invoke", name, "MB/s", 2.0 * length * index / (1024.0 * 1024.0) / elapsed);
+
+        data.parameters.count = 2;
+        data.parameters.value[1].datatype = DWScript_DataType_Integer;
+        data.parameters.value[1].i = calls;
+        start = now();
+        if (loop)
+            DWScript_invoke(loop, &data);
+        elapsed = now() - start;
+        printf("%-24s %-9s %10d calls in %8.3fs (%8.1f MB/s out and in)\n", "UTF8 callback", name, calls, elapsed, 2.0 * length * calls / (1024.0 * 1024.0) / elapsed);
+        record("UTF8 callback", name, "MB/s", 2.0 * length * calls / (1024.0 * 1024.0) / elapsed);
+        DWScript_endExecution(execution);
+    }
+    DWScript_destroyExecution(execution);
+    DWScript_destroyProgram(program);
+}
+
+/** compiles the same script repeatedly, without and then with the shared program cache */
+static void benchmarkCompiles(DWScriptContext context, int compiles)
+{
+    static const char *script =
+        "function Fib(n : integer) : integer;\n"
+        "begin\n"
+        "  if n < 2 then result := n else result := Fib(n - 1) + Fib(n - 2);\n"
+        "end;\n"
+        "var i, total : integer;\n"
+        "begin\n"
+        "  for i := 1 to 10 do total := total + Add(Fib(i), i);\n"
+        "end.";
+    DWScript_CacheStatistics statistics;
+    double                   start, elapsed;
+    int                      index;
+
+    start = now();
+    for (index = 0; index < compiles; index++)
+        DWScript_compile(context, script, DWScript_Flags_None);
+    elapsed = now() - start;
+    printf("%-24s %10d compiles in %8.3fs (%12.0f compiles/s)\n", "compile", compiles, elapsed, compiles / elapsed);
+    record("compile", "", "ms", 1000.0 * elapsed / compiles);
+
+    start = now();
+    for (index = 0; index < compiles; index++)
+        DWScript_compile(context, script, DWScript_Flags_Cache);
+    elapsed = now() - start;
+    printf("%-24s %10d compiles in %8.3fs (%12.0f compiles/s)\n", "compile (cached)", compiles, elapsed, compiles / elapsed);
+    record("compile (cached)", "", "ms", 1000.0 * elapsed / compiles);
+
+    if (DWScript_getCacheStatistics(&statistics))
+        printf("%-24s %d/%d programs, %d hits, %d misses, %d evictions\n", "program cache", statistics.count, statistics.capacity, statistics.hits, statistics.misses, statistics.evictions);
+}
+
+/** prints what the context's runs so far cost, then shows a runaway script being stopped by a timeout */
+static void benchmarkLimits(DWScriptContext context)
+{
+    DWScript_Statistics statistics;
+    DWScript_Limits     limits = { 0 };
+    double              start, elapsed;
+
+    if (DWScript_getStatistics(context, &statistics, 1))
+        printf("%-24s %d runs in %dms, %d host calls, %d objects, %d stack bytes\n", "execute statistics", statistics.runs, statistics.wallMilliseconds, statistics.hostCallbacks, statistics.allocations, statistics.peakStackBytes);
+
+    limits.timeoutMilliseconds = 100;
+    DWScript_setLimits(context, &limits);
+    if (DWScript_compile(context, "while true do ;", DWScript_Flags_None))
+    {
+        start = now();
+        DWScript_execute(context, DWScript_Flags_None);
+        elapsed = now() - start;
+        DWScript_getStatistics(context, &statistics, 1);
+        printf("%-24s stopped after %8.3fs (%d timeouts)\n", "timeout (100ms)", elapsed, statistics.timeouts);
+    }
+    limits.timeoutMilliseconds = 0;
+    DWScript_setLimits(context, &limits);
+}
+
+/** parses a generated JSON document straight from UTF-8, then has a script walk it, then has the script parse it from a string */
+static void benchmarkJSON(DWScriptContext context, int items, int repeats)
+{
+    static const char *script =
+        "function Total(doc : JSONVariant) : Float;\n"
+        "var i : integer;\n"
+        "begin\n"
+        "  for i := 0 to doc.length() - 1 do\n"
+        "    result := result + doc[i].price;\n"
+        "end;\n"
+        "function TotalText(text : String) : Float;\n"
+        "begin\n"
+        "  result := Total(JSON.Parse(text));\n"
+        "end;\n"
+        "begin end.";
+    DWScript_Data  data;
+    DWScriptJSON   json;
+    char          *text, *end;
+    double         start, elapsed, megabytes;
+    int            index, length;
+
+    text = (char*)malloc(items * 64 + 16);
+    end  = text;
+    *end++ = '[';
+    for (index = 0; index < items; index++)
+        end += sprintf(end, "%s{\"id\":%d,\"name\":\"item \\u00e9 %d\",\"price\":%d.5}", index ? "," : "", index, index, index & 0xFF);
+    *end++ = ']';
+    *end   = 0;
+    length    = (int)(end - text);
+    megabytes = (double)length * repeats / (1024.0 * 1024.0);
+
+    start = now();
+    for (index = 0; index < repeats; index++)
+    {
+        json = DWScript_parseJSON(context, text, length);
+        if (!json)
+            break;
+        DWScript_destroyJSON(json);
+    }
+    elapsed = now() - start;
+    printf("%-24s %10d bytes x %d in %8.3fs (%8.1f MB/s)\n", "ParseJSON (UTF-8)", length, index, elapsed, megabytes / elapsed);
+    record("ParseJSON (UTF-8)", "", "MB/s", megabytes / elapsed);
+
+    if (!DWScript_compile(context, script, DWScript_Flags_None))
+    {
+        free(text);
+        return;
+    }
+
+    memset(&data, 0, sizeof(data));
+    data.parameters.count = 1;
+    data.parameters.value[0].datatype = DWScript_DataType_JSON;
+    start = now();
+    for (index = 0; index < repeats; index++)
+    {
+        json = DWScript_parseJSON(context, text, length);
+        data.parameters.value[0].j = json;
+        if (!json || !DWScript_callStateless(context, "Total", &data))
+            break;
+        DWScript_destroyJSON(json);
+    }
+    elapsed = now() - start;
+    printf("%-24s %10d bytes x %d in %8.3fs (%8.1f MB/s)\n", "ParseJSON + script walk", length, index, elapsed, megabytes / elapsed);
+    record("ParseJSON + script walk", "", "MB/s", megabytes / elapsed);
+
+    data.parameters.value[0].datatype = DWScript_DataType_String;
+    data.parameters.value[0].s = text;
+    start = now();
+    for (index = 0; index < repeats; index++)
+    {
+        if (!DWScript_callStateless(context, "TotalText", &data))
+            break;
+    }
+    elapsed = now() - start;
+    printf("%-24s %10d bytes x %d in %8.3fs (%8.1f MB/s)\n", "JSON.Parse + script walk", length, index, elapsed, megabytes / elapsed);
+    record("JSON.Parse + script walk", "", "MB/s", megabytes / elapsed);
+
+    free(text);
+}
+
+typedef struct OutputStats
+{
+    double    start, firstChunk;
+    long long bytes;
+    int       chunks;
+}
+OutputStats;
+
+void __stdcall output(const char *text, int length, void *userData)
+{
+    OutputStats *stats = (OutputStats*)userData;
+    if (!stats->chunks++)
+        stats->firstChunk = now() - stats->start;
+    stats->bytes += length;
+}
+
+/** renders a large page, collected in memory as before and then streamed to a sink, timing the first byte the host sees */
+static void benchmarkOutput(DWScriptContext context, int lines)
+{
+    OutputStats stats = { 0 };
+    double      elapsed;
+
+    sprintf(buffer,
+        "var i : integer;\n"
+        "begin\n"
+        "  PrintLn('<table>');\n"
+        "  for i := 1 to %d do\n"
+        "    PrintLn('<tr><td>' + IntToStr(i) + '</td><td>row '#233' ' + IntToStr(i * 7) + '</td><td>' + FloatToStr(i / 3) + '</td></tr>');\n"
+        "  PrintLn('</table>');\n"
+        "end.", lines);
+    if (!DWScript_compile(context, buffer, DWScript_Flags_None))
+        return;
+
+    stats.start = now();
+    DWScript_execute(context, DWScript_Flags_None);
+    elapsed = now() - stats.start;
+    printf("%-24s %10d lines in %8.3fs, first byte after the run\n", "output (in memory)", lines, elapsed);
+    record("output (in memory)", "", "s", elapsed);
+
+    DWScript_setOutput(context, output, &stats, 0);
+    stats.start = now();
+    DWScript_execute(context, DWScript_Flags_None);
+    elapsed = now() - stats.start;
+    printf("%-24s %10d lines in %8.3fs, first byte after %8.6fs (%d chunks, %8.1f MB/s)\n", "output (streamed)", lines, elapsed, stats.firstChunk, stats.chunks, stats.bytes / (1024.0 * 1024.0) / elapsed);
+    record("output (streamed)", "", "s", elapsed);
+    record("output (streamed)", "", "first byte s", stats.firstChunk);
+    DWScript_setOutput(context, NULL, NULL, 0);
+}
+
+/** compiles one of a family of different scripts calling the registered Host%d functions, returning 0 if it fails */
+static int compileColdStartScript(DWScriptContext context, int index, int functions)
+{
+    DWScriptProgram program;
+
+    sprintf(buffer,
+        "function Step(n : integer) : integer;\n"
+        "begin\n"
+        "  result := Host%d(n, %d) + Host%d(n, 1);\n"
+        "end;\n"
+        "var i, total : integer;\n"
+        "begin\n"
+        "  for i := 1 to 10 do total := total + Step(i);\n"
+        "end.", index % functions, index, (index * 7) % functions);
+    program = DWScript_createProgram(context, buffer, DWScript_Flags_None);
+    if (!program)
+    {
+        DWScript_getMessage(context, buffer, 1024);
+        printf("%-24s could not compile: %s\n", "cold start", buffer);
+        return 0;
+    }
+    DWScript_destroyProgram(program);
+    return 1;
+}
+
+/** compiles a batch of different scripts in a new context with many registered functions, as a process starting up would.
+    first with the symbols of the registered functions rebuilt for every compile, as they were before they were cached,
+    by setting a return type again before each one, then with the symbols built once and reused */
+static void benchmarkColdStart(int scripts, int functions)
+{
+    DWScriptContext  context;
+    DWScriptFunction first = NULL;
+    char             name[32];
+    double           start, rebuilt, cached;
+    int              index;
+
+    context = DWScript_createContext(DWScript_Flags_None);
+    if (!context)
+        return;
+    for (index = 0; index < functions; index++)
+    {
+        DWScriptFunction function;
+
+        sprintf(name, "Host%d", index);
+        function = DWScript_addFunction(context, name, add, NULL);
+        DWScript_addParameter(context, function, "a", DWScript_DataType_Integer);
+        DWScript_addParameter(context, function, "b", DWScript_DataType_Integer);
+        DWScript_setReturnType(context, function, DWScript_DataType_Integer);
+        if (!first)
+            first = function;
+    }
+
+    start = now();
+    for (index = 0; index < scripts; index++)
+    {
+        DWScript_setReturnType(context, first, DWScript_DataType_Integer);
+        if (!compileColdStartScript(context, index, functions))
+        {
+            DWScript_destroyContext(context);
+            return;
+        }
+    }
+    rebuilt = now() - start;
+
+    start = now();
+    for (index = 0; index < scripts; index++)
+    {
+        if (!compileColdStartScript(context, scripts + index, functions))
+        {
+            DWScript_destroyContext(context);
+            return;
+        }
+    }
+    cached = now() - start;
+
+    printf("%-24s %10d scripts in %8.3fs (%8.3fms each, %d functions registered)\n", "cold start (rebuilt)", scripts, rebuilt, 1000.0 * rebuilt / scripts, functions);
+    printf("%-24s %10d scripts in %8.3fs (%8.3fms each, %5.2fx)\n", "cold start (symbols)", scripts, cached, 1000.0 * cached / scripts, rebuilt / cached);
+    record("cold start", "symbols rebuilt", "ms", 1000.0 * rebuilt / scripts);
+    record("cold start", "symbols cached", "ms", 1000.0 * cached / scripts);
+
+    DWScript_destroyContext(context);
+}
+
+/** has scripts sum and update a host array through a callback per element, then in place, then reads two fields of an array of structs */
+static void benchmarkSharedArrays(DWScriptContext context, int count)
+{
+    Item *items;
+    int   i;
+
+    values = (double*)malloc(count * sizeof(double));
+    items  = (Item*)malloc(count * sizeof(Item));
+    for (i = 0; i < count; i++)
+    {
+        values[i]         = i * 0.25;
+        items[i].price    = (i % 100) * 1.5;
+        items[i].quantity = i % 7;
+    }
+    DWScript_shareArray(context, "values", DWScript_ElementType_Double, values, count, 0, 0);
+    DWScript_shareArray(context, "prices", DWScript_ElementType_Double, &items[0].price, count, sizeof(Item), 1);
+    DWScript_shareArray(context, "quantities", DWScript_ElementType_Int32, &items[0].quantity, count, sizeof(Item), 1);
+
+    sprintf(buffer,
+        "var i : integer; total : float;\n"
+        "begin\n"
+        "  for i := 0 to %d do\n"
+        "    total := total + Value(i);\n"
+        "end.", count - 1);
+    benchmarkCallbacks(context, "array sum (callback)", buffer, count);
+
+    benchmarkCallbacks(context, "array sum (shared)",
+        "var h, i : integer; total : float;\n"
+        "begin\n"
+        "  h := HostArray('values');\n"
+        "  for i := 0 to HostLength(h) - 1 do\n"
+        "    total := total + HostGetFloat(h, i);\n"
+        "end.", count);
+
+    benchmarkCallbacks(context, "array update (shared)",
+        "var h, i : integer;\n"
+        "begin\n"
+        "  h := HostArray('values');\n"
+        "  for i := 0 to HostLength(h) - 1 do\n"
+        "    HostSetFloat(h, i, HostGetFloat(h, i) * 2);\n"
+        "end.", count);
+    if (values[count - 1] != (count - 1) * 0.5)
+        printf("%-24s did not write the host array\n", "array update (shared)");
+
+    benchmarkCallbacks(context, "struct fields (shared)",
+        "var p, q, i : integer; total : float;\n"
+        "begin\n"
+        "  p := HostArray('prices');\n"
+        "  q := HostArray('quantities');\n"
+        "  for i := 0 to HostLength(p) - 1 do\n"
+        "    total := total + HostGetFloat(p, i) * HostGetInteger(q, i);\n"
+        "end.", count);
+
+    DWScript_shareArray(context, "values", DWScript_ElementType_Double, NULL, 0, 0, 0);
+    DWScript_shareArray(context, "prices", DWScript_ElementType_Double, NULL, 0, 0, 0);
+    DWScript_shareArray(context, "quantities", DWScript_ElementType_Int32, NULL, 0, 0, 0);
+    free(items);
+    free(values);
+    values = NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    HMODULE          handle;
+    DWScriptContext  context;
+    int              calls = 1000000;
+
+    if (argc > 1)
+        calls = atoi(argv[1]);
+
+    handle = DWScript_initialise(argc > 2 ? argv[2] : DEFAULT_LIBRARY);
+    if (!handle)
+    {
+#ifdef _WIN32
+        printf("Could not load DWScript DLL (%d)\n", (int)GetLastError());
+#else
+        printf("Could not load DWScript library (%s)\n", dlerror());
+#endif
+        return -1;
+    }
+    if (argc > 3 && !(results = fopen(argv[3], "w")))
+    {
+        printf("Could not open %s for the results\n", argv[3]);
+        return -1;
+    }
+    if (results)
+        fprintf(results, "benchmark\tvariant\tmetric\tvalue\n");
+
+    context = DWScript_createContext(DWScript_Flags_None);
+    if (!context)
+    {
+        printf("Could not create context\n");
+        return -1;
+    }
+
+    {
+        DWScriptFunction function = DWScript_addFunction(context, "Add", add, NULL);
+        DWScript_addParameter(context, function, "a", DWScript_DataType_Integer);
+        DWScript_addParameter(context, function, "b", DWScript_DataType_Integer);
+        DWScript_setReturnType(context, function, DWScript_DataType_Integer);
+    }
+    {
+        DWScriptFunction function = DWScript_addFunction(context, "Scale", scale, NULL);
+        DWScript_addParameter(context, function, "value", DWScript_DataType_Float);
+        DWScript_setReturnType(context, function, DWScript_DataType_Float);
+    }
+    {
+        DWScriptFunction function = DWScript_addFunction(context, "Echo", echo, NULL);
+        DWScript_addParameter(context, function, "s", DWScript_DataType_UTF8);
+        DWScript_setReturnType(context, function, DWScript_DataType_UTF8);
+    }
+    {
+        DWScriptFunction function = DWScript_addFunction(context, "Value", value, NULL);
+        DWScript_addParameter(context, function, "index", DWScript_DataType_Integer);
+        DWScript_setReturnType(context, function, DWScript_DataType_Float);
+    }
+
+    sprintf(buffer,
+        "var i, total : integer;\n"
+        "begin\n"
+        "  for i := 1 to %d do\n"
+        "    total := Add(total, i) mod 1000;\n"
+        "end.", calls);
+    benchmarkCallbacks(context, "callback (integer x2)", buffer, calls);
+    benchmarkProfiling(context, buffer, calls);
+
+    sprintf(buffer,
+        "var i : integer; total : float;\n"
+        "begin\n"
+        "  for i := 1 to %d do\n"
+        "    total := total + Scale(i);\n"
+        "end.", calls);
+    benchmarkCallbacks(context, "callback (float x1)", buffer, calls);
+    benchmarkLimits(context);
+
+    benchmarkLatency(context, calls / 10);
+
+    {
+        DWScriptProgram program;
+        int             processors = processorCount();
+
+        sprintf(buffer,
+            "var i, total : integer;\n"
+            "begin\n"
+            "  for i := 1 to %d do\n"
+            "    total := Add(total, i) mod 1000;\n"
+            "end.", calls);
+        program = DWScript_createProgram(context, buffer, DWScript_Flags_None);
+        if (program)
+        {
+            benchmarkThreadedCallbacks(program, calls, processors);
+            DWScript_destroyProgram(program);
+        }
+
+        program = DWScript_createProgram(context, "var i, total : integer; begin for i := 1 to 1000 do total := Add(total, i) mod 1000; end.", DWScript_Flags_None);
+        if (program)
+        {
+            benchmarkAsync(program, calls / 1000, processors * 2);
+            DWScript_destroyProgram(program);
+        }
+    }
+
+    benchmarkScriptCalls(context, calls / 10);
+    benchmarkStrings(context, "ascii", "The quick brown fox jumps over the lazy dog, again and again and again.", calls / 10);
+    benchmarkStrings(context, "non-ascii", "Z\xc3\xbc" "rich, K\xc3\xb8" "benhavn, \xce\x91\xce\xb8\xce\xae\xce\xbd\xce\xb1, \xe6\x9d\xb1\xe4\xba\xac, \xf0\x9f\x98\x80" " and back.", calls / 10);
+    benchmarkStrings(context, "short", "key", calls / 10);
+    benchmarkCompiles(context, 100);
+    benchmarkColdStart(300, 200);
+    benchmarkJSON(context, calls / 10, 10);
+    benchmarkOutput(context, calls / 10);
+    benchmarkSharedArrays(context, calls);
+
+    DWScript_destroyContext(context);
+    DWScript_finalise(handle);
+    if (results)
+        fclose(results);
+    return 0;
+}
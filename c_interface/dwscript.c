@@ -7,16 +7,29 @@
  * Normal execution process would be something like:
  * HMODULE handle = DWScript_initialise("dwscript.dll");
  *    //you can make as many contexts as you like, but cannot mix and match contexts as you wish
- *    DWScriptContext context = DWScript_createContext();
+ *    DWScriptContext context = DWScript_createContext(DWScript_Flags_None);
  *    //add any local C functions into the context with DWScript_addFunction() and DWScript_addParameter() before compiling
- *    DWScript_compile(context, "begin end."); //only necessary once per context
- *       DWScript_run(context); //call as many times as you like
+ *    DWScript_compile(context, "begin end.", DWScript_Flags_None); //only necessary once per context
+ *       DWScript_execute(context, DWScript_Flags_None); //call as many times as you like
+ *    //or compile a program once and give each thread an execution of its own
+ *    DWScriptProgram program = DWScript_createProgram(context, "begin end.", DWScript_Flags_Cache);
+ *       DWScriptExecution execution = DWScript_createExecution(program);
+ *          DWScript_run(execution, DWScript_Flags_None); //call as many times as you like
+ *       DWScript_destroyExecution(execution);
+ *    DWScript_destroyProgram(program);
  *    DWScript_destroyContext(context);
  * DWScript_finalise(handle);
  */
 
 #include "dwscript.h"
 
+#ifndef _WIN32
+/* the same loader over dlopen(), the shared library exports the same names as the DLL */
+#define LoadLibraryA(path)           dlopen(path, RTLD_NOW | RTLD_LOCAL)
+#define GetProcAddress(handle, name) dlsym(handle, name)
+#define FreeLibrary(handle)          dlclose(handle)
+#endif
+
 HMODULE DWScript_initialise(const char *dllPath)
 {
     HMODULE handle;
@@ -24,16 +37,44 @@ HMODULE DWScript_initialise(const char *dllPath)
     if ((handle = LoadLibraryA(dllPath)) == NULL)
         return NULL;
 
-    DWScript_addFunction    = (LP_DWS_ADDFUNCTION)GetProcAddress(handle, "AddFunction");
-    DWScript_addParameter   = (LP_DWS_ADDPARAMETER)GetProcAddress(handle, "AddParameter");
-    DWScript_setReturnType  = (LP_DWS_SETRETURNTYPE)GetProcAddress(handle, "SetReturnType");
-    DWScript_compile        = (LP_DWS_COMPILE)GetProcAddress(handle, "Compile");
-    DWScript_execute        = (LP_DWS_EXECUTE)GetProcAddress(handle, "Execute");
-    DWScript_call           = (LP_DWS_CALL)GetProcAddress(handle, "Call");
-    DWScript_callStateless  = (LP_DWS_CALLSTATELESS)GetProcAddress(handle, "CallStateless");
-    DWScript_getMessage     = (LP_DWS_GETMESSAGE)GetProcAddress(handle, "GetMessage");
-    DWScript_createContext  = (LP_DWS_CREATECONTEXT)GetProcAddress(handle, "CreateContext");
-    DWScript_destroyContext = (LP_DWS_DESTROYCONTEXT)GetProcAddress(handle, "DestroyContext");
+    DWScript_addFunction        = (LP_DWS_ADDFUNCTION)GetProcAddress(handle, "AddFunction");
+    DWScript_addParameter       = (LP_DWS_ADDPARAMETER)GetProcAddress(handle, "AddParameter");
+    DWScript_setReturnType      = (LP_DWS_SETRETURNTYPE)GetProcAddress(handle, "SetReturnType");
+    DWScript_compile            = (LP_DWS_COMPILE)GetProcAddress(handle, "Compile");
+    DWScript_execute            = (LP_DWS_EXECUTE)GetProcAddress(handle, "Execute");
+    DWScript_call               = (LP_DWS_CALL)GetProcAddress(handle, "Call");
+    DWScript_callStateless      = (LP_DWS_CALLSTATELESS)GetProcAddress(handle, "CallStateless");
+    DWScript_getMessage         = (LP_DWS_GETMESSAGE)GetProcAddress(handle, "GetMessage");
+    DWScript_createContext      = (LP_DWS_CREATECONTEXT)GetProcAddress(handle, "CreateContext");
+    DWScript_destroyContext     = (LP_DWS_DESTROYCONTEXT)GetProcAddress(handle, "DestroyContext");
+    DWScript_createProgram      = (LP_DWS_CREATEPROGRAM)GetProcAddress(handle, "CreateProgram");
+    DWScript_destroyProgram     = (LP_DWS_DESTROYPROGRAM)GetProcAddress(handle, "DestroyProgram");
+    DWScript_createExecution    = (LP_DWS_CREATEEXECUTION)GetProcAddress(handle, "CreateExecution");
+    DWScript_destroyExecution   = (LP_DWS_DESTROYEXECUTION)GetProcAddress(handle, "DestroyExecution");
+    DWScript_run                = (LP_DWS_RUN)GetProcAddress(handle, "Run");
+    DWScript_beginExecution     = (LP_DWS_BEGINEXECUTION)GetProcAddress(handle, "BeginExecution");
+    DWScript_endExecution       = (LP_DWS_ENDEXECUTION)GetProcAddress(handle, "EndExecution");
+    DWScript_findFunction       = (LP_DWS_FINDFUNCTION)GetProcAddress(handle, "FindFunction");
+    DWScript_invoke             = (LP_DWS_INVOKE)GetProcAddress(handle, "Invoke");
+    DWScript_invokeBatch        = (LP_DWS_INVOKEBATCH)GetProcAddress(handle, "InvokeBatch");
+    DWScript_setCacheCapacity   = (LP_DWS_SETCACHECAPACITY)GetProcAddress(handle, "SetCacheCapacity");
+    DWScript_getCacheStatistics = (LP_DWS_GETCACHESTATISTICS)GetProcAddress(handle, "GetCacheStatistics");
+    DWScript_runAsync           = (LP_DWS_RUNASYNC)GetProcAddress(handle, "RunAsync");
+    DWScript_cancel             = (LP_DWS_CANCEL)GetProcAddress(handle, "Cancel");
+    DWScript_wait               = (LP_DWS_WAIT)GetProcAddress(handle, "Wait");
+    DWScript_destroyJob         = (LP_DWS_DESTROYJOB)GetProcAddress(handle, "DestroyJob");
+    DWScript_setWorkerCount     = (LP_DWS_SETWORKERCOUNT)GetProcAddress(handle, "SetWorkerCount");
+    DWScript_getPoolStatistics  = (LP_DWS_GETPOOLSTATISTICS)GetProcAddress(handle, "GetPoolStatistics");
+    DWScript_setProfiling       = (LP_DWS_SETPROFILING)GetProcAddress(handle, "SetProfiling");
+    DWScript_resetProfile       = (LP_DWS_RESETPROFILE)GetProcAddress(handle, "ResetProfile");
+    DWScript_getProfile         = (LP_DWS_GETPROFILE)GetProcAddress(handle, "GetProfile");
+    DWScript_setLimits          = (LP_DWS_SETLIMITS)GetProcAddress(handle, "SetLimits");
+    DWScript_getStatistics      = (LP_DWS_GETSTATISTICS)GetProcAddress(handle, "GetStatistics");
+    DWScript_parseJSON          = (LP_DWS_PARSEJSON)GetProcAddress(handle, "ParseJSON");
+    DWScript_getJSON            = (LP_DWS_GETJSON)GetProcAddress(handle, "GetJSON");
+    DWScript_destroyJSON        = (LP_DWS_DESTROYJSON)GetProcAddress(handle, "DestroyJSON");
+    DWScript_setOutput          = (LP_DWS_SETOUTPUT)GetProcAddress(handle, "SetOutput");
+    DWScript_shareArray         = (LP_DWS_SHAREARRAY)GetProcAddress(handle, "ShareArray");
 
     if (!DWScript_addFunction || 
         !DWScript_addParameter || 
@@ -43,7 +84,35 @@ HMODULE DWScript_initialise(const char *dllPath)
         !DWScript_callStateless || 
         !DWScript_getMessage || 
         !DWScript_createContext || 
-        !DWScript_destroyContext)
+        !DWScript_destroyContext ||
+        !DWScript_createProgram ||
+        !DWScript_destroyProgram ||
+        !DWScript_createExecution ||
+        !DWScript_destroyExecution ||
+        !DWScript_run ||
+        !DWScript_beginExecution ||
+        !DWScript_endExecution ||
+        !DWScript_findFunction ||
+        !DWScript_invoke ||
+        !DWScript_invokeBatch ||
+        !DWScript_setCacheCapacity ||
+        !DWScript_getCacheStatistics ||
+        !DWScript_runAsync ||
+        !DWScript_cancel ||
+        !DWScript_wait ||
+        !DWScript_destroyJob ||
+        !DWScript_setWorkerCount ||
+        !DWScript_getPoolStatistics ||
+        !DWScript_setProfiling ||
+        !DWScript_resetProfile ||
+        !DWScript_getProfile ||
+        !DWScript_setLimits ||
+        !DWScript_getStatistics ||
+        !DWScript_parseJSON ||
+        !DWScript_getJSON ||
+        !DWScript_destroyJSON ||
+        !DWScript_setOutput ||
+        !DWScript_shareArray)
     {
         FreeLibrary(handle);
         return NULL;
@@ -53,6 +122,9 @@ HMODULE DWScript_initialise(const char *dllPath)
 
 void DWScript_finalise(HMODULE handle)
 {
-    if (handle)
-        FreeLibrary(handle);
+    if (!handle)
+        return;
+    //stop the worker threads while it is still safe to wait on them, before the DLL starts unloading
+    DWScript_setWorkerCount(0);
+    FreeLibrary(handle);
 }
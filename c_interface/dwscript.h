@@ -6,12 +6,18 @@
  * \version      1.0.1.0
  *
  * Normal execution process would be something like:
- * HMODULE handle = DWScript_initialise("dwscript.dll");
+ * HMODULE handle = DWScript_initialise("dwscript.dll"); //or "./libdwscript.so" elsewhere
  *    //you can make as many contexts as you like, but cannot mix and match contexts as you wish
  *    DWScriptContext context = DWScript_createContext(DWScript_Flags_Ole | DWScript_Flags_Asm);
  *    //add any local C functions into the context with DWScript_addFunction() and DWScript_addParameter() before compiling
  *    DWScript_compile(context, "begin end.", DWScript_Flags_Jitter); //only necessary once per context
- *       DWScript_execute(context); //call as many times as you like
+ *       DWScript_execute(context, DWScript_Flags_None); //call as many times as you like
+ *    //or compile a program once and give each thread an execution of its own
+ *    DWScriptProgram program = DWScript_createProgram(context, "begin end.", DWScript_Flags_Cache);
+ *       DWScriptExecution execution = DWScript_createExecution(program);
+ *          DWScript_run(execution, DWScript_Flags_None); //call as many times as you like
+ *       DWScript_destroyExecution(execution);
+ *    DWScript_destroyProgram(program);
  *    DWScript_destroyContext(context);
  * DWScript_finalise(handle);
  */
@@ -22,12 +28,34 @@
 extern "C" {
 #endif
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+/* the library is loaded with dlopen(), its handle standing in for the module handle */
+#include <dlfcn.h>
+#include <stddef.h>
+typedef void* HMODULE;
+#if defined(__i386__)
+#define __stdcall __attribute__((stdcall))
+#else
+#define __stdcall /* x86-64 has the one calling convention, which Free Pascal uses for stdcall exports too */
+#endif
+#endif
 
 /* TYPES */
 typedef void* DWScriptContext;
 typedef void* DWScriptState;
 typedef void* DWScriptFunction;
+typedef void* DWScriptProgram;
+typedef void* DWScriptExecution;
+typedef void* DWScriptCallable;
+typedef void* DWScriptJob;
+typedef void* DWScriptJSON;
+
+/** Called on a worker thread when a job submitted with DWScript_runAsync() finishes, success is non-zero if the script ran without errors */
+typedef void              (__stdcall *DWScript_CompletionCallback)(DWScriptJob job, int success, void *userdata);
+/** Called on the executing thread with the next chunk of a script's Print() output, the UTF-8 text is not NUL terminated and is only valid until the callback returns */
+typedef void              (__stdcall *DWScript_OutputCallback)(const char *text, int length, void *userdata);
 
 typedef enum DWScript_DataType
 {
@@ -36,6 +64,8 @@ typedef enum DWScript_DataType
 	DWScript_DataType_Integer,
 	DWScript_DataType_String,
 	DWScript_DataType_Boolean,
+	DWScript_DataType_JSON,    /**< a JSONVariant in the script, passed as a DWScriptJSON handle */
+	DWScript_DataType_UTF8,    /**< a String in the script, passed as DWScript_UTF8 without going through the system code page */
 
 	DWScript_DataType_Invalid = 65536 /**< promotes this type to an integer, do not use */
 }
@@ -47,35 +77,80 @@ typedef enum DWScript_Flags
 	DWScript_Flags_Jitter  = 1 << 0, /**< enable JIT engine (DWScript_createContext()) */
 	DWScript_Flags_Ole     = 1 << 1, /**< add OLE support to script environment (DWScript_createContext()) */
 	DWScript_Flags_Asm     = 1 << 2, /**< add ASM support to script environment, requires NASM executable (DWScript_execute()) */
+	DWScript_Flags_Cache   = 1 << 3, /**< reuse a previously compiled program from the shared program cache (DWScript_compile(), DWScript_createProgram()) */
 
 	DWScript_Flags_Invalid = 65536 /**< promotes this type to an integer, do not use */
 }
 DWScript_Flags;
 
-/** Poor implementation of a variant-type variable for passing between C and DWScript */
+/** The layouts DWScript_getProfile() can report samples in, one entry per line */
+typedef enum DWScript_ProfileFormat
+{
+	DWScript_ProfileFormat_Lines = 0,  /**< "samples<TAB>source<TAB>line<TAB>function", host callbacks show as source "[host]" */
+	DWScript_ProfileFormat_Functions,  /**< "samples<TAB>calls<TAB>function", self samples per function, calls are only counted for host callbacks */
+	DWScript_ProfileFormat_Collapsed,  /**< "outer;inner;innermost samples", the folded stack format read by flame graph tools */
+
+	DWScript_ProfileFormat_Invalid = 65536 /**< promotes this type to an integer, do not use */
+}
+DWScript_ProfileFormat;
+
+/** The element types of a host array shared with DWScript_shareArray() */
+typedef enum DWScript_ElementType
+{
+	DWScript_ElementType_Int32 = 0, /**< int */
+	DWScript_ElementType_Int64,     /**< long long */
+	DWScript_ElementType_Float,     /**< float */
+	DWScript_ElementType_Double,    /**< double */
+	DWScript_ElementType_Boolean,   /**< one byte, non-zero being true */
+
+	DWScript_ElementType_Invalid = 65536 /**< promotes this type to an integer, do not use */
+}
+DWScript_ElementType;
+
+/** UTF-8 text and its length in bytes.\n
+    Text passed in need not be NUL terminated, a length of -1 meaning it is. Text handed out always is, the length not counting it. */
+typedef struct DWScript_UTF8
+{
+    const char *text;
+    int         length;
+}
+DWScript_UTF8;
+
+/** Poor implementation of a variant-type variable for passing between C and DWScript.\n
+    Integers are 64-bit, as they are in scripts, booleans are ints.\n
+    ABI note: the DWScript_UTF8 member made the union as wide as a pointer and an int, and with 64-bit integers this struct grew from 12 to 16 bytes on 32-bit
+    and from 24 to 32 bytes on 64-bit, DWScript_Data (which holds 33 of them) growing with it. Code built against a dwscript.h from before DWScript_DataType_UTF8 must be rebuilt. */
 typedef struct DWScript_Variable
 {
     const char        *name;
     DWScript_DataType  datatype;
     union
     {
-        float f;
-        int   i;
-        char *s;
-        int   b;
+        float     f;
+        long long i;
+        char     *s;
+        int       b;
+        void     *j;
+        DWScript_UTF8 u;
     };
 }
 DWScript_Variable;
 
 /** A structure used to pass data to and from the DWScript context.\n
     This is passed in to a registered C callback function and contains the parameters in the .parameters.value array. The result of the function should be stored in the .result variable.\n
+    Each callback invocation gets its own copy, so it (and any string or JSON parameters in it) is only valid until the callback returns,
+    this is what makes it safe for the same context to be executing on several threads at once, or to recurse through DWScript_call().\n
     To call a Pascal function in the script, you would set up one of these structs containing the parameters for it in a similar way, obtaining the return value in the .result variable. */
 typedef struct DWScript_Data
 {
     DWScriptContext    context;      /**< when in a C callback method, this is the context responsible for calling it */
     DWScriptState      state;        /**< when in a C callback method, this is the current execution state, useful for using the DWScript_Call() function */
     const char        *functionName; /**< when in a C callback method, this is the registered name of the function in the script context */
-    DWScript_Variable  result;       /**< this stores the return value of a function */
+    DWScript_Variable  result;       /**< this stores the return value of a function, a string result is owned by the handle the call was made on and stays valid until the same thread gets another string result through it,
+                                          or until 64 other threads have had string results through that handle since,
+                                          a JSON result is a new handle to be destroyed with DWScript_destroyJSON().
+                                          set its datatype to DWScript_DataType_UTF8 before calling to have a string result returned as UTF-8, with the same lifetime as a string result.
+                                          a UTF-8 result of a C callback may point into its parameters */
     struct
     {
         int               count;     /**< this indicates how many parameters there are */
@@ -84,16 +159,107 @@ typedef struct DWScript_Data
 }
 DWScript_Data;
 
-typedef DWScriptContext  (__stdcall *LP_DWS_CREATECONTEXT)(DWScript_Flags flags);
-typedef void             (__stdcall *LP_DWS_DESTROYCONTEXT)(DWScriptContext context);
-typedef DWScriptFunction (__stdcall *LP_DWS_ADDFUNCTION)(DWScriptContext context, const char *name, void *function, void *userdata);
-typedef int              (__stdcall *LP_DWS_ADDPARAMETER)(DWScriptContext context, DWScriptFunction function, const char *name, DWScript_DataType datatype);
-typedef int              (__stdcall *LP_DWS_SETRETURNTYPE)(DWScriptContext context, DWScriptFunction function, DWScript_DataType datatype);
-typedef int              (__stdcall *LP_DWS_COMPILE)(DWScriptContext context, const char *script, DWScript_Flags flags);
-typedef int              (__stdcall *LP_DWS_EXECUTE)(DWScriptContext context, DWScript_Flags flags);
-typedef int              (__stdcall *LP_DWS_CALL)(DWScriptContext context, DWScriptState state, const char *name, DWScript_Data *data);
-typedef int              (__stdcall *LP_DWS_CALLSTATELESS)(DWScriptContext context, const char *name, DWScript_Data *data);
-typedef int              (__stdcall *LP_DWS_GETMESSAGE)(DWScriptContext context, char *message, int size);
+/** One column of a batch passed to DWScript_invokeBatch(), one element per row.\n
+    Integers are 64-bit, as in DWScript_Variable, booleans are stored as ints, any non-zero value being true. */
+typedef struct DWScript_Column
+{
+    DWScript_DataType  datatype; /**< the type of every element in this column */
+    union
+    {
+        float          *f;
+        long long      *i;
+        char          **s;
+        int            *b;
+        DWScript_UTF8  *u;
+    };
+}
+DWScript_Column;
+
+/** Counters describing the shared program cache, see DWScript_getCacheStatistics() */
+typedef struct DWScript_CacheStatistics
+{
+    int capacity;  /**< the most programs the cache will hold before evicting the least recently used */
+    int count;     /**< how many programs the cache currently holds */
+    int hits;      /**< how many compiles were satisfied from the cache */
+    int misses;    /**< how many compiles asked for the cache but had to compile */
+    int evictions; /**< how many programs were dropped to make space */
+}
+DWScript_CacheStatistics;
+
+/** Counters describing the worker pool used by DWScript_runAsync(), see DWScript_getPoolStatistics() */
+typedef struct DWScript_PoolStatistics
+{
+    int workers;    /**< how many worker threads are running, 0 until the pool is first used */
+    int busy;       /**< how many workers are busy with a job */
+    int queued;     /**< how many jobs are waiting for a worker, the current queue depth */
+    int peakQueued; /**< the deepest the queue has been */
+    int submitted;  /**< how many jobs have been submitted */
+    int completed;  /**< how many jobs have finished */
+    int cancelled;  /**< how many jobs were cancelled, whether before they started or while running */
+}
+DWScript_PoolStatistics;
+
+/** Resource limits for scripts, see DWScript_setLimits(), 0 leaves any of them at its default */
+typedef struct DWScript_Limits
+{
+    int timeoutMilliseconds; /**< how long a run may take before it is stopped, by default there is no limit */
+    int maxRecursionDepth;   /**< how deeply script functions may recurse, 1024 by default */
+    int maxDataSize;         /**< how many bytes the script stack may grow to, by default there is no limit */
+    int stackChunkSize;      /**< how many stack entries are added each time the stack grows, 4096 by default, contexts only */
+}
+DWScript_Limits;
+
+/** Counters describing what a context or execution has done, see DWScript_getStatistics() */
+typedef struct DWScript_Statistics
+{
+    int runs;             /**< how many times the script was run, through DWScript_execute() on a context or DWScript_run(), DWScript_beginExecution() and DWScript_runAsync() on an execution */
+    int timeouts;         /**< how many of those runs were stopped by their timeout */
+    int wallMilliseconds; /**< the total time taken by those runs */
+    int lastMilliseconds; /**< the time taken by the latest run */
+    int hostCallbacks;    /**< how many calls the script made into host functions, including during DWScript_invoke() */
+    int allocations;      /**< how many script objects were created */
+    int peakStackBytes;   /**< the largest the script stack has grown to, it is allocated in stackChunkSize steps and never shrinks */
+}
+DWScript_Statistics;
+
+typedef DWScriptContext   (__stdcall *LP_DWS_CREATECONTEXT)(DWScript_Flags flags);
+typedef void              (__stdcall *LP_DWS_DESTROYCONTEXT)(DWScriptContext context);
+typedef DWScriptFunction  (__stdcall *LP_DWS_ADDFUNCTION)(DWScriptContext context, const char *name, void *function, void *userdata);
+typedef int               (__stdcall *LP_DWS_ADDPARAMETER)(DWScriptContext context, DWScriptFunction function, const char *name, DWScript_DataType datatype);
+typedef int               (__stdcall *LP_DWS_SETRETURNTYPE)(DWScriptContext context, DWScriptFunction function, DWScript_DataType datatype);
+typedef int               (__stdcall *LP_DWS_COMPILE)(DWScriptContext context, const char *script, DWScript_Flags flags);
+typedef int               (__stdcall *LP_DWS_EXECUTE)(DWScriptContext context, DWScript_Flags flags);
+typedef int               (__stdcall *LP_DWS_CALL)(DWScriptContext context, DWScriptState state, const char *name, DWScript_Data *data);
+typedef int               (__stdcall *LP_DWS_CALLSTATELESS)(DWScriptContext context, const char *name, DWScript_Data *data);
+typedef int               (__stdcall *LP_DWS_GETMESSAGE)(void *handle, char *message, int size);
+typedef DWScriptProgram   (__stdcall *LP_DWS_CREATEPROGRAM)(DWScriptContext context, const char *script, DWScript_Flags flags);
+typedef void              (__stdcall *LP_DWS_DESTROYPROGRAM)(DWScriptProgram program);
+typedef DWScriptExecution (__stdcall *LP_DWS_CREATEEXECUTION)(DWScriptProgram program);
+typedef void              (__stdcall *LP_DWS_DESTROYEXECUTION)(DWScriptExecution execution);
+typedef int               (__stdcall *LP_DWS_RUN)(DWScriptExecution execution, DWScript_Flags flags);
+typedef int               (__stdcall *LP_DWS_BEGINEXECUTION)(DWScriptExecution execution, DWScript_Flags flags);
+typedef void              (__stdcall *LP_DWS_ENDEXECUTION)(DWScriptExecution execution);
+typedef DWScriptCallable  (__stdcall *LP_DWS_FINDFUNCTION)(DWScriptExecution execution, const char *name);
+typedef int               (__stdcall *LP_DWS_INVOKE)(DWScriptCallable callable, DWScript_Data *data);
+typedef int               (__stdcall *LP_DWS_INVOKEBATCH)(DWScriptCallable callable, const DWScript_Column *columns, int columnCount, int rowCount, DWScript_Column *results);
+typedef void              (__stdcall *LP_DWS_SETCACHECAPACITY)(int capacity);
+typedef int               (__stdcall *LP_DWS_GETCACHESTATISTICS)(DWScript_CacheStatistics *statistics);
+typedef DWScriptJob       (__stdcall *LP_DWS_RUNASYNC)(DWScriptExecution execution, int timeoutMilliseconds, DWScript_CompletionCallback callback, void *userdata);
+typedef int               (__stdcall *LP_DWS_CANCEL)(DWScriptJob job);
+typedef int               (__stdcall *LP_DWS_WAIT)(DWScriptJob job, int timeoutMilliseconds);
+typedef void              (__stdcall *LP_DWS_DESTROYJOB)(DWScriptJob job);
+typedef int               (__stdcall *LP_DWS_SETWORKERCOUNT)(int count);
+typedef int               (__stdcall *LP_DWS_GETPOOLSTATISTICS)(DWScript_PoolStatistics *statistics);
+typedef int               (__stdcall *LP_DWS_SETPROFILING)(DWScriptContext context, int intervalMilliseconds);
+typedef void              (__stdcall *LP_DWS_RESETPROFILE)(DWScriptContext context);
+typedef int               (__stdcall *LP_DWS_GETPROFILE)(DWScriptContext context, DWScript_ProfileFormat format, char *buffer, int size);
+typedef int               (__stdcall *LP_DWS_SETLIMITS)(void *handle, const DWScript_Limits *limits);
+typedef int               (__stdcall *LP_DWS_GETSTATISTICS)(void *handle, DWScript_Statistics *statistics, int reset);
+typedef DWScriptJSON      (__stdcall *LP_DWS_PARSEJSON)(DWScriptContext context, const char *text, int length);
+typedef int               (__stdcall *LP_DWS_GETJSON)(DWScriptJSON json, char *buffer, int size);
+typedef void              (__stdcall *LP_DWS_DESTROYJSON)(DWScriptJSON json);
+typedef int               (__stdcall *LP_DWS_SETOUTPUT)(void *handle, DWScript_OutputCallback callback, void *userdata, int bufferSize);
+typedef int               (__stdcall *LP_DWS_SHAREARRAY)(DWScriptContext context, const char *name, DWScript_ElementType elementType, void *data, int count, int stride, int readOnly);
 
 /* FUNCTIONS */
 
@@ -211,15 +377,308 @@ LP_DWS_CALL /* int */DWScript_call/*(DWScriptContext context, DWScriptState stat
 */
 LP_DWS_CALLSTATELESS /* int */DWScript_callStateless/*(DWScriptContext context, const char *name, DWScript_Data *data)*/;
 
+/**
+    This compiles the provided script into a new program, separate from the one DWScript_compile() stores in the context.\n
+    A program can be shared by any number of executions created with DWScript_createExecution(), which can be run on different
+    threads at the same time, only paying for their own stack and globals rather than a compile each.\n
+    NOTE: it is necessary to register any functions before calling this using DWScript_addFunction() and DWScript_addParameter(),
+          and the program must be destroyed before the context it was compiled in.
+    \param   context   an existing context created with DWScript_createContext
+    \param   script    the script to compile
+    \param   flags     features to support during compiling the script.\n
+                       bitmask of: DWScript_Flags_None, DWScript_Flags_Jitter
+    \return  a new program on success, or NULL on failure, use DWScript_getMessage() on the context for more information
+*/
+LP_DWS_CREATEPROGRAM /* DWScriptProgram */DWScript_createProgram/*(DWScriptContext context, const char *script, DWScript_Flags flags)*/;
+
+/**
+    This frees a program created with DWScript_createProgram(). Executions created from it remain usable until they are destroyed.
+    \param   program  the program to destroy
+*/
+LP_DWS_DESTROYPROGRAM /* void */DWScript_destroyProgram/*(DWScriptProgram program)*/;
+
+/**
+    This creates a new execution of a compiled program, with its own stack and global variables.
+    \param   program  an existing program created with DWScript_createProgram
+    \return  a new execution on success, or NULL on failure, use DWScript_getMessage() on the program for more information
+*/
+LP_DWS_CREATEEXECUTION /* DWScriptExecution */DWScript_createExecution/*(DWScriptProgram program)*/;
+
+/**
+    This frees an execution created with DWScript_createExecution(). It must not be running synchronously at the time,
+    a job of it still queued or running on the worker pool is cancelled and waited for.\n
+    This cannot be called from within that job's own run, the execution is then left alone and DWScript_getMessage() on it says so.
+    \param   execution  the execution to destroy
+*/
+LP_DWS_DESTROYEXECUTION /* void */DWScript_destroyExecution/*(DWScriptExecution execution)*/;
+
+/**
+    This runs the main body of an execution's program.\n
+    An execution can be run as many times as you like, but by only one thread at a time, create one execution per thread instead.
+    \warning this function blocks while executing
+    \param   execution  an existing execution created with DWScript_createExecution
+    \param   flags      can only be DWScript_Flags_None for now.\n
+    /return  non-zero on success, 0 on failure, use DWScript_getMessage() on the execution for more information
+*/
+LP_DWS_RUN /* int */DWScript_run/*(DWScriptExecution execution, DWScript_Flags flags)*/;
+
+/**
+    This starts a persistent session on an execution: the main body of the program is run to set up any globals,
+    after which the execution is kept alive so its functions can be invoked as many times as you like with DWScript_invoke(),
+    without creating and tearing down an execution for every call like DWScript_callStateless() does.\n
+    End the session with DWScript_endExecution(), after which the execution can be begun or run again.
+    \warning this function blocks while executing
+    \param   execution  an existing execution created with DWScript_createExecution
+    \param   flags      can only be DWScript_Flags_None for now.\n
+    /return  non-zero on success, 0 on failure, use DWScript_getMessage() on the execution for more information
+*/
+LP_DWS_BEGINEXECUTION /* int */DWScript_beginExecution/*(DWScriptExecution execution, DWScript_Flags flags)*/;
+
+/**
+    This ends a session started with DWScript_beginExecution(), running any finalization sections and releasing its globals.\n
+    Any functions found with DWScript_findFunction() are freed and must not be used after this.
+    \param   execution  an execution begun with DWScript_beginExecution
+*/
+LP_DWS_ENDEXECUTION /* void */DWScript_endExecution/*(DWScriptExecution execution)*/;
+
+/**
+    This resolves a script function once, so it can be invoked repeatedly with DWScript_invoke() without looking it up by name again.
+    \param   execution  an execution begun with DWScript_beginExecution
+    \param   name       the name of the script function to find
+    \return  a handle to the function, valid until the execution is ended, or NULL on failure,
+             use DWScript_getMessage() on the execution for more information
+*/
+LP_DWS_FINDFUNCTION /* DWScriptCallable */DWScript_findFunction/*(DWScriptExecution execution, const char *name)*/;
+
+/**
+    This calls a script function found with DWScript_findFunction(), within the state of its begun execution.\n
+    Functions that only take and return integers, floats, booleans and strings by value are called directly as their declared types,
+    so the parameter types in data must match those, though integers are accepted for floats and booleans, and UTF-8 for strings.\n
+    Like the execution it belongs to, it can only be used by one thread at a time.
+    \warning this function blocks while executing
+    \param   callable  a function found with DWScript_findFunction
+    \param   data      any parameters you wish to pass the function must be set in this, the return value of the function will
+                       also be stored in this structure.  If this is NULL, the function will be called with no parameters,
+                       and the return result discarded.
+    /return  non-zero on success, 0 on failure, use DWScript_getMessage() on the execution for more information
+*/
+LP_DWS_INVOKE /* int */DWScript_invoke/*(DWScriptCallable callable, DWScript_Data *data)*/;
+
+/**
+    This calls a script function found with DWScript_findFunction() once for every row of a batch, in a single trip into the DLL.\n
+    Column n holds the values of parameter n for every row, so the call set up and type checks are paid once per batch rather than per call.
+    Rows are called through the same typed path as DWScript_invoke(), so only functions it calls directly can be batched, and the column types are checked
+    against the declared ones as for its parameters before the first row is called.
+    \warning this function blocks while executing
+    \param   callable     a function found with DWScript_findFunction
+    \param   columns      one column per parameter of the function, each holding rowCount values
+    \param   columnCount  the number of columns, which must match the number of parameters, up to 32
+    \param   rowCount     the number of times to call the function
+    \param   results      a column with rowCount elements to receive the return values, of the type the function is declared to return.
+                          Integer results may also go in a float column, boolean results in an integer column, and string results in a UTF-8 column.
+                          String and UTF-8 results are owned by the execution and are valid until the next batch or until it is destroyed.
+                          If this is NULL, the return values are discarded.
+    /return  non-zero on success, 0 on failure, use DWScript_getMessage() on the execution for more information, which includes the failing row
+*/
+LP_DWS_INVOKEBATCH /* int */DWScript_invokeBatch/*(DWScriptCallable callable, const DWScript_Column *columns, int columnCount, int rowCount, DWScript_Column *results)*/;
+
+/**
+    This sets how many compiled programs the shared program cache may hold, the least recently used are evicted beyond that.\n
+    The cache is only consulted by DWScript_compile() and DWScript_createProgram() when passed DWScript_Flags_Cache,
+    a program is reused when the script text, the compile flags and every registered function (including its callback and userdata)
+    match exactly. The capacity is shared by all contexts, but a program calls back into the functions of the context that compiled it,
+    so it is only ever reused by that same context. Destroying a context removes its programs from the cache.
+    \param   capacity  the maximum number of programs to cache, 0 empties and disables the cache. Defaults to 64.
+*/
+LP_DWS_SETCACHECAPACITY /* void */DWScript_setCacheCapacity/*(int capacity)*/;
+
+/**
+    This fills in the current counters of the shared program cache.
+    \param   statistics  the structure to fill
+    /return  non-zero on success, 0 if statistics is NULL
+*/
+LP_DWS_GETCACHESTATISTICS /* int */DWScript_getCacheStatistics/*(DWScript_CacheStatistics *statistics)*/;
+
+/**
+    This queues an execution to be run on the worker pool and returns immediately, the execution must not be used until the job has finished.\n
+    The callback is made on the worker thread once the run has finished, been cancelled or timed out, after which DWScript_wait() returns.
+    Do not destroy the job from within the callback, DWScript_setWorkerCount() fails there.
+    \param   execution            an existing execution created with DWScript_createExecution, which has not been begun
+    \param   timeoutMilliseconds  the run is stopped if it takes longer than this, 0 for no limit
+    \param   callback             called when the job finishes, can be NULL
+    \param   userdata             this can be a pointer to whatever you like, it will simply be passed in to the callback, can be NULL
+    \return  a handle to the job, or NULL on failure (e.g., the execution is already queued, or the pool was stopped with DWScript_setWorkerCount(0)), use DWScript_getMessage() on the execution
+             for more information. Once finished, DWScript_getMessage() on the job gives the outcome of the run.
+*/
+LP_DWS_RUNASYNC /* DWScriptJob */DWScript_runAsync/*(DWScriptExecution execution, int timeoutMilliseconds, DWScript_CompletionCallback callback, void *userdata)*/;
+
+/**
+    This cancels a job, if it is still queued it will not be run, if it is running the script is asked to stop.\n
+    Either way its callback is still made, with success set to 0.
+    \param   job  a job returned by DWScript_runAsync
+    /return  non-zero if the job had not yet finished
+*/
+LP_DWS_CANCEL /* int */DWScript_cancel/*(DWScriptJob job)*/;
+
+/**
+    This blocks until a job has finished, including its callback.
+    \param   job                  a job returned by DWScript_runAsync
+    \param   timeoutMilliseconds  how long to wait, or -1 to wait as long as it takes
+    /return  non-zero if the job has finished, 0 if it timed out
+*/
+LP_DWS_WAIT /* int */DWScript_wait/*(DWScriptJob job, int timeoutMilliseconds)*/;
+
+/**
+    This frees a job returned by DWScript_runAsync(), cancelling it and waiting for it if it has not finished yet.
+    \param   job  the job to destroy
+*/
+LP_DWS_DESTROYJOB /* void */DWScript_destroyJob/*(DWScriptJob job)*/;
+
+/**
+    This sets how many worker threads service DWScript_runAsync(), waiting for any busy workers to finish their current job first.
+    Jobs still queued are kept and picked up by the new workers.\n
+    Setting it to 0 stops the pool for good: jobs still queued are cancelled there and then, their callbacks being made on this thread
+    with success set to 0, and DWScript_runAsync() fails until this is called again with a count above 0.\n
+    The pool is started on first use with one worker per processor, and DWScript_finalise() stops it by setting this to 0.
+    It fails when called on a worker thread, from a script or a completion callback, as the worker would be waiting for itself to stop.
+    \param   count  the number of workers, 0 stops the pool and cancels everything queued
+    \return  non-zero on success, 0 if called on a worker thread
+*/
+LP_DWS_SETWORKERCOUNT /* int */DWScript_setWorkerCount/*(int count)*/;
+
+/**
+    This fills in the current counters of the worker pool.
+    \param   statistics  the structure to fill
+    /return  non-zero on success, 0 if statistics is NULL
+*/
+LP_DWS_GETPOOLSTATISTICS /* int */DWScript_getPoolStatistics/*(DWScript_PoolStatistics *statistics)*/;
+
+/**
+    This turns sampling on or off for every run started in the context from now on, through DWScript_execute(), DWScript_run(),
+    DWScript_beginExecution() or DWScript_runAsync() on its programs. Runs already in progress are not affected.
+
+    Each sample records the script line and call stack being executed, or the host callback being waited on.
+    Samples accumulate until DWScript_resetProfile() is called.
+    \param   context               the context to profile
+    \param   intervalMilliseconds  the time between samples, 0 turns profiling off
+    /return  non-zero on success, 0 if the interval is negative
+*/
+LP_DWS_SETPROFILING /* int */DWScript_setProfiling/*(DWScriptContext context, int intervalMilliseconds)*/;
+
+/**
+    This discards the samples and host call counts gathered so far in a context.
+    \param   context  the context to reset
+*/
+LP_DWS_RESETPROFILE /* void */DWScript_resetProfile/*(DWScriptContext context)*/;
+
+/**
+    This fills a buffer with a text report of the samples gathered in a context, see DWScript_ProfileFormat.
+    \param   context  the profiled context
+    \param   format   the layout of the report
+    \param   buffer   the buffer to hold the report or NULL if you wish to obtain its length
+    \param   size     the capacity of the buffer, the report will be truncated to fit this.
+    /return  if buffer is NULL, this will be the length of the report, otherwise it will be the amount
+             of characters filled into the buffer.
+*/
+LP_DWS_GETPROFILE /* int */DWScript_getProfile/*(DWScriptContext context, DWScript_ProfileFormat format, char *buffer, int size)*/;
+
+/**
+    This sets the resource limits of a context or an execution. A script that exceeds one of them fails with a runtime error.
+
+    Limits set on a context are compiled into the programs it compiles from then on, and become the defaults of their executions.
+    Limits set on an execution override its program's until set again, a 0 going back to the program's. The stack of an execution
+    is already set up when it is created, so stackChunkSize must be 0 for executions.
+
+    A timeout also covers each DWScript_invoke() and DWScript_invokeBatch() call, and an execution stopped during one of them must be ended.
+    \param   handle  an existing context or execution
+    \param   limits  the limits to apply
+    /return  non-zero on success, 0 if a limit is negative or cannot be applied to the handle
+*/
+LP_DWS_SETLIMITS /* int */DWScript_setLimits/*(void *handle, const DWScript_Limits *limits)*/;
+
+/**
+    This fills in the counters of a context or an execution, which accumulate from its creation or the last reset.
+    Do not call this for an execution that is running on another thread.
+    \param   handle      an existing context or execution
+    \param   statistics  the structure to fill
+    \param   reset       non-zero to zero the counters once read, so the next call only covers what happens in between
+    /return  non-zero on success, 0 if statistics is NULL or the handle is neither a context nor an execution
+*/
+LP_DWS_GETSTATISTICS /* int */DWScript_getStatistics/*(void *handle, DWScript_Statistics *statistics, int reset)*/;
+
+/**
+    This parses a UTF-8 JSON document straight from the buffer it is in, the result can be passed to script functions taking a JSONVariant.
+
+    A JSON handle shares its document with the script it is passed to, so changes the script makes to it are seen through the handle.
+    \param   context  an existing context, which receives any parse errors
+    \param   text     the UTF-8 text of the document, which need not be NUL terminated if length is given
+    \param   length   the length of the text in bytes, or -1 if it is NUL terminated
+    \return  a new JSON handle on success, or NULL on failure, use DWScript_getMessage() on the context for more information
+*/
+LP_DWS_PARSEJSON /* DWScriptJSON */DWScript_parseJSON/*(DWScriptContext context, const char *text, int length)*/;
+
+/**
+    This fills a buffer with the UTF-8 text of a JSON document.\n
+    The document is serialised afresh by every call, as a script sharing it may change it in between, so the length returned by a query
+    may no longer be enough by the time the buffer is filled. Allow some room, or query again if the text filled the buffer.
+    \param   json    an existing JSON handle
+    \param   buffer  the buffer to hold the text or NULL if you wish to obtain its length
+    \param   size    the capacity of the buffer, the text will be truncated to fit this.
+    /return  if buffer is NULL, this will be the length of the text, otherwise it will be the amount
+             of characters filled into the buffer.
+*/
+LP_DWS_GETJSON /* int */DWScript_getJSON/*(DWScriptJSON json, char *buffer, int size)*/;
+
+/**
+    This releases a JSON handle obtained from DWScript_parseJSON() or from a JSON function result,
+    the document lives on for as long as a script still holds it.
+    \param   json  the handle to destroy
+*/
+LP_DWS_DESTROYJSON /* void */DWScript_destroyJSON/*(DWScriptJSON json)*/;
+
+/**
+    This streams what scripts Print() to a callback, in chunks of at most bufferSize bytes, instead of collecting it in memory.
+    The buffer is handed over whenever it fills, and whenever a run, an invoke or the end of an execution returns, so memory use stays the
+    same however much a script prints.
+
+    A sink set on a context is used by its own runs, and by the runs of executions created from its programs that have none of their own.
+    It is taken up when a run begins, so an execution already begun keeps the sink it began with.
+    \param   handle      an existing context or execution
+    \param   callback    the sink, or NULL to collect the output in memory again
+    \param   userdata    passed to the callback as is
+    \param   bufferSize  the size of the buffer in bytes, 0 for the default of 64KB
+    /return  non-zero on success, 0 if the buffer size is negative or the handle is neither a context nor an execution
+*/
+LP_DWS_SETOUTPUT /* int */DWScript_setOutput/*(void *handle, DWScript_OutputCallback callback, void *userdata, int bufferSize)*/;
+
+/**
+    This lets the scripts of a context read and write a buffer of yours in place, without copying it in or out and without a callback per element.
+    Scripts look the array up once with HostArray('name') and then use the handle it returns with HostLength(handle),
+    HostGetInteger/HostGetFloat/HostGetBoolean(handle, index) and HostSetInteger/HostSetFloat/HostSetBoolean(handle, index, value),
+    converting to and from the element type as they go. Indices start at 0 and are bounds checked like those of a script array.
+
+    A run uses the arrays shared when it began, so the buffers must stay valid until runs begun before unsharing them have ended,
+    and this must not be called while the context's runs are starting on other threads.
+    \param   context      an existing context
+    \param   name         what scripts call the array, sharing a name again replaces it
+    \param   elementType  the type of each element
+    \param   data         the first element, or NULL to stop sharing the name
+    \param   count        the number of elements
+    \param   stride       the bytes from one element to the next, 0 if they are packed, so one field of an array of structs can be shared
+    \param   readOnly     non-zero to make scripts fail when they write to the array
+    /return  non-zero on success, 0 if the arguments are invalid
+*/
+LP_DWS_SHAREARRAY /* int */DWScript_shareArray/*(DWScriptContext context, const char *name, DWScript_ElementType elementType, void *data, int count, int stride, int readOnly)*/;
+
 /**
     This fills a buffer with information about the latest failure encountered during operation.
-    \param   context  an existing context created with DWScript_createContext
+    \param   handle   an existing context, program, execution, job or JSON handle, whichever the failing call was made on
     \param   message  the buffer to hold the message or NULL if you wish to obtain the length of the message being held
     \param   size     the capacity of the message buffer, the status will be truncated to fit this.
     /return  if message is NULL, this will be the length of the message available, otherwise it will be the amount
              of characters filled into the message buffer.
 */
-LP_DWS_GETMESSAGE /* int */DWScript_getMessage/*(DWScriptContext context, char *message, int size)*/;
+LP_DWS_GETMESSAGE /* int */DWScript_getMessage/*(void *handle, char *message, int size)*/;
 
 #ifdef __cplusplus
 }
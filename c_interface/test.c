@@ -35,7 +35,7 @@ void __stdcall test(DWScript_Data *dwsData, void *userData)
             switch(dwsData->parameters.value[index].datatype)
             {
                 case DWScript_DataType_Float:   printf("%.2f\n", dwsData->parameters.value[index].f); break;
-                case DWScript_DataType_Integer: printf("%d\n",   dwsData->parameters.value[index].i); break;
+                case DWScript_DataType_Integer: printf("%lld\n", dwsData->parameters.value[index].i); break;
                 case DWScript_DataType_String:  printf("%s\n",   dwsData->parameters.value[index].s); break;
                 case DWScript_DataType_Boolean: printf("%d\n",   dwsData->parameters.value[index].b); break;
             }
@@ -54,7 +54,7 @@ void __stdcall test(DWScript_Data *dwsData, void *userData)
             if (parameter.result.datatype != DWScript_DataType_Integer)
                 printf("Incorrect return type from TimesTwo() (Expected %s, got %s)\n", typeNames[DWScript_DataType_Integer], typeNames[parameter.result.datatype]);
             else
-                printf("TimesTwo(%d) returned value: %d\n", parameter.parameters.value[0].i, parameter.result.i);
+                printf("TimesTwo(%lld) returned value: %lld\n", parameter.parameters.value[0].i, parameter.result.i);
         }
         else
         {
@@ -150,6 +150,38 @@ int main(int argc, char *argv[])
        then use DWScript_callStateless as many times as you like to use that or any other utility function.
        NOTE: the utility function cannot use global data as it has no state, it must essentially be a static function */
 
+    /* a function can also be called over a whole batch of rows at once, integers are 64-bit here as they are in scripts */
+    {
+        long long         values[3]  = { 21, 3000000000LL, -5000000000LL };
+        long long         doubled[3] = { 0, 0, 0 };
+        DWScript_Column   column, results;
+        DWScriptProgram   program   = DWScript_createProgram(context, script, DWScript_Flags_None);
+        DWScriptExecution execution = program ? DWScript_createExecution(program) : NULL;
+        int               index;
+
+        column.datatype  = DWScript_DataType_Integer;
+        column.i         = values;
+        results.datatype = DWScript_DataType_Integer;
+        results.i        = doubled;
+        if (execution && DWScript_beginExecution(execution, DWScript_Flags_None))
+        {
+            DWScriptCallable callable = DWScript_findFunction(execution, "TimesTwo");
+            if (callable && DWScript_invokeBatch(callable, &column, 1, 3, &results))
+            {
+                for (index = 0; index < 3; index++)
+                    printf("TimesTwo(%lld) in a batch returned value: %lld%s\n", values[index], doubled[index], doubled[index] == values[index] * 2 ? "" : " (WRONG)");
+            }
+            else
+            {
+                DWScript_getMessage(execution, buffer, 1024);
+                printf("Could not invoke batch: %s\n", buffer);
+            }
+            DWScript_endExecution(execution);
+        }
+        DWScript_destroyExecution(execution);
+        DWScript_destroyProgram(program);
+    }
+
     DWScript_destroyContext(context);
     //FIXME: trying to free the DLL handle hangs, so the DLL is doing something wrong... for now just let the OS clean up after us...
     //DWScript_finalise(handle);
@@ -14,17 +14,26 @@ UNIT deell;
     {$define JITTER}
   {$endif}
 {$endif}
+{$if defined(CPUX86) or defined(CPUX64) or defined(CPUI386) or defined(CPUX86_64)}
+  {$define UNALIGNED_READS} //text is scanned a word at a time, and is rarely aligned
+{$ifend}
 
 INTERFACE
 
 USES
-  Classes, dwsComp, dwsCompiler, dwsExprs, dwsCoreExprs, sysutils, variants, dwsAsmLibModule,
+  Classes, dwsComp, dwsCompiler, dwsCompilerUtils, dwsExprs, dwsCoreExprs, dwsConstExprs, dwsSymbols, dwsXPlatform, dwsUtils, dwsErrors, dwsStrings, dwsStack,
+  sysutils, variants, dwsJSON, dwsJSONConnector, dwsFunctions, dwsMagicExprs, dwsExprList,
+{$ifdef MSWINDOWS}
+  dwsAsmLibModule, //assembles through NASM and runs the code in memory it allocates with Windows calls
+{$endif}
 {$ifdef JITTER}
   dwsJIT, dwsJITx86,
 {$endif}
 {$ifdef FPC}
-  contnrs
+  contnrs, syncobjs
 {$else}
+  Windows,
+  SyncObjs,
   dwsComConnector,
   Generics.Collections,
   ComObj,
@@ -38,22 +47,44 @@ CONST
   DATATYPE_INTEGER = 2;
   DATATYPE_STRING  = 3;
   DATATYPE_BOOLEAN = 4;
+  DATATYPE_JSON    = 5;
+  DATATYPE_UTF8    = 6;
 
 CONST
   FLAG_NONE   = 0;
   FLAG_JITTER = 1 SHL 0;
   FLAG_OLE    = 1 SHL 1;
   FLAG_ASM    = 1 SHL 2;
+  FLAG_CACHE  = 1 SHL 3;
+
+CONST
+  PROFILE_LINES     = 0;
+  PROFILE_FUNCTIONS = 1;
+  PROFILE_COLLAPSED = 2;
+
+CONST
+  ELEMENT_INT32   = 0;
+  ELEMENT_INT64   = 1;
+  ELEMENT_FLOAT   = 2;
+  ELEMENT_DOUBLE  = 3;
+  ELEMENT_BOOLEAN = 4; //one byte, non-zero being true
 
 TYPE
+  DWScript_UTF8 = RECORD
+    text   : PAnsiChar;
+    length : Integer; //bytes, -1 if text is NUL terminated
+  END;
+
   DWScript_Variable = RECORD
     name     : PAnsiChar;
     dataType : Integer;
     CASE Integer OF
       DATATYPE_FLOAT   : (f : Single);
-      DATATYPE_INTEGER : (i : Integer);
+      DATATYPE_INTEGER : (i : Int64);
       DATATYPE_STRING  : (s : PAnsiChar);
       DATATYPE_BOOLEAN : (b : Boolean);
+      DATATYPE_JSON    : (j : Pointer);
+      DATATYPE_UTF8    : (u : DWScript_UTF8);
   END;
 
   DWScript_DataPtr = ^DWScript_Data;
@@ -66,29 +97,292 @@ TYPE
     value        : ARRAY[0..31] OF DWScript_Variable;
   END;
 
+  DWScript_IntegerArray = ARRAY[0..$FFFFFF] OF Integer;
+  DWScript_Int64Array   = ARRAY[0..$FFFFFF] OF Int64;
+  DWScript_FloatArray   = ARRAY[0..$FFFFFF] OF Single;
+  DWScript_StringArray  = ARRAY[0..$FFFFFF] OF PAnsiChar;
+  DWScript_UTF8Array    = ARRAY[0..$FFFFFF] OF DWScript_UTF8;
+
+  DWScript_ColumnPtr = ^DWScript_Column;
+  DWScript_Column = RECORD
+    dataType : Integer;
+    CASE Integer OF
+      DATATYPE_FLOAT   : (f : ^DWScript_FloatArray);
+      DATATYPE_INTEGER : (i : ^DWScript_Int64Array);
+      DATATYPE_STRING  : (s : ^DWScript_StringArray);
+      DATATYPE_BOOLEAN : (b : ^DWScript_IntegerArray);
+      DATATYPE_UTF8    : (u : ^DWScript_UTF8Array);
+  END;
+  DWScript_Columns = ARRAY[0..31] OF DWScript_Column;
+
+  DWScript_CacheStatisticsPtr = ^DWScript_CacheStatistics;
+  DWScript_CacheStatistics = RECORD
+    capacity  : Integer;
+    count     : Integer;
+    hits      : Integer;
+    misses    : Integer;
+    evictions : Integer;
+  END;
+
+  DWScript_PoolStatisticsPtr = ^DWScript_PoolStatistics;
+  DWScript_PoolStatistics = RECORD
+    workers    : Integer;
+    busy       : Integer;
+    queued     : Integer;
+    peakQueued : Integer;
+    submitted  : Integer;
+    completed  : Integer;
+    cancelled  : Integer;
+  END;
+
+  DWScript_LimitsPtr = ^DWScript_Limits;
+  DWScript_Limits = RECORD
+    timeoutMilliseconds : Integer;
+    maxRecursionDepth   : Integer;
+    maxDataSize         : Integer;
+    stackChunkSize      : Integer;
+  END;
+
+  DWScript_StatisticsPtr = ^DWScript_Statistics;
+  DWScript_Statistics = RECORD
+    runs             : Integer;
+    timeouts         : Integer;
+    wallMilliseconds : Integer;
+    lastMilliseconds : Integer;
+    hostCallbacks    : Integer;
+    allocations      : Integer;
+    peakStackBytes   : Integer;
+  END;
+
 TYPE
   DWScript_CallbackFunction = PROCEDURE(parameters : DWScript_DataPtr; userdata : Pointer); STDCALL;
+  DWScript_CompletionFunction = PROCEDURE(job : Pointer; success : Integer; userdata : Pointer); STDCALL;
+  DWScript_OutputFunction = PROCEDURE(text : PAnsiChar; length : Integer; userdata : Pointer); STDCALL;
 { ----- ---------------------------------------------------------------------------------------------------------------------------------- ----- }
 
 TYPE
+  DWScript_ReturnString = RECORD
+    thread : TThreadID;
+    used   : Cardinal; //returnClock when the thread last took a string, the least recent slot is the one reused
+    text   : AnsiString;
+    utf8   : AnsiString; //only ever grows, so returning UTF-8 stops allocating once it is big enough
+  END;
+
+  { base of every object handed out to C as a handle, it carries the message reported by GetMessage() }
+  DWScript_Object = CLASS(TObject)
+  PROTECTED
+    statusText    : AnsiString;
+    statusLock    : TFixedCriticalSection; //also guards returnStrings
+    returnStrings : ARRAY OF DWScript_ReturnString; //string results handed back to C, one per calling thread, up to RETURN_SLOTS
+    returnClock   : Cardinal;
+
+  PROTECTED
+    FUNCTION getStatus : AnsiString;
+    PROCEDURE setStatus(CONST value : AnsiString);
+    { every thread executing through this object may report here, so access is serialised }
+    PROPERTY status : AnsiString READ getStatus WRITE setStatus;
+    FUNCTION returnSlot : Integer;
+    { keeps a string result alive for C, until the same thread returns another string through this object }
+    FUNCTION keepString(CONST value : UnicodeString) : PAnsiChar;
+    { as keepString, but as UTF-8 rather than through the system code page }
+    PROCEDURE keepUTF8(CONST value : UnicodeString; VAR text : DWScript_UTF8);
+
+  PUBLIC
+    PROPERTY Message : AnsiString READ getStatus;
+  PUBLIC
+    CONSTRUCTOR Create;
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+TYPE
+  { short strings decoded lately on one thread, keyed by a hash of their UTF-8, so those that keep crossing (names, keys, flags)
+    are shared by reference rather than decoded and allocated again }
+  DWScript_TextCache = CLASS(TObject)
+  PROTECTED
+    bytes : ARRAY[0..255] OF AnsiString;
+    texts : ARRAY[0..255] OF UnicodeString;
+
+  PROTECTED
+    FUNCTION decode(text : PAnsiChar; length : Integer) : UnicodeString;
+  END;
+
+TYPE
+  DWScript_Context = CLASS;
+
+  { samples gathered from every profiled run in a context, see DWScript_Sampler }
+  DWScript_Profile = CLASS(TObject)
+  PROTECTED
+    lock     : TFixedCriticalSection;
+    enabled  : Boolean;
+    interval : Integer;     //milliseconds between samples
+    lines    : TStringList; //'source'#9'line'#9'function' -> samples
+    stacks   : TStringList; //'outer;inner;innermost' -> samples
+
+  PROTECTED
+    PROCEDURE add(CONST line, stack : String; count : Integer);
+    PROCEDURE reset;
+  PUBLIC
+    CONSTRUCTOR Create;
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+  { the sampling half of dwsSampling.TdwsSamplingDebugger, without its multimedia timer and the VCL units its base debugger needs.
+    a shared clock thread only counts ticks, which the executing thread turns into samples at its next statement,
+    so the script's position and call stack are never read from another thread. host callbacks find it through DWScript_Monitor }
+  DWScript_Sampler = CLASS(TInterfacedSelfObject, IDebugger)
+  PROTECTED
+    profile  : DWScript_Profile;
+    interval : Integer;
+    due      : Int64;   //written by the clock only
+    ticks    : Integer; //written by the clock only
+    taken    : Integer; //written by the executing thread only
+    lastExpr : TExprBase;
+    stack    : TTightStack;
+
+  PROTECTED
+    PROCEDURE StartDebug(exec : TdwsExecution);
+    PROCEDURE DoDebug(exec : TdwsExecution; expr : TExprBase);
+    PROCEDURE StopDebug(exec : TdwsExecution);
+    PROCEDURE EnterFunc(exec : TdwsExecution; funcExpr : TExprBase);
+    PROCEDURE LeaveFunc(exec : TdwsExecution; funcExpr : TExprBase);
+    FUNCTION  LastDebugStepExpr : TExprBase;
+    PROCEDURE DebugMessage(CONST msg : UnicodeString);
+    PROCEDURE NotifyException(exec : TdwsExecution; CONST exceptObj : IScriptObj);
+  PUBLIC
+    DESTRUCTOR Destroy; OVERRIDE;
+    { turns any ticks since the last sample into samples of the current position, or of the host callback named }
+    PROCEDURE collect(CONST hostName : String);
+  END;
+
+  DWScript_SamplingClock = CLASS(TdwsThread)
+  PROTECTED
+    PROCEDURE Execute; OVERRIDE;
+  END;
+
+  { where the output of a run goes, set with SetOutput() }
+  DWScript_SinkPtr = ^DWScript_Sink;
+  DWScript_Sink = RECORD
+    callback : DWScript_OutputFunction; //NIL to keep the output in memory, as the engine does
+    userData : Pointer;
+    size     : Integer; //bytes buffered before they are handed over
+  END;
+
+  { the result type of every context, it gives each run a DWScript_Output writing to the sink of whoever started the run.
+    it holds no state of its own, so one is shared by all contexts and the programs they leave in the cache.
+    it extends the engine's default result, which contexts used before; dwsStringResult's Write/WriteLn result type was never set up here }
+  DWScript_OutputType = CLASS(TdwsDefaultResultType)
+  PUBLIC
+    FUNCTION CreateProgResult : TdwsResult; OVERRIDE;
+  END;
+
+  { the output of a run, UTF-8 encoded into a fixed buffer which is handed to the sink whenever it fills and whenever the run returns to the host,
+    so memory stays the same however much a script prints. without a sink it collects the output in memory like TdwsDefaultResult }
+  DWScript_Output = CLASS(TdwsDefaultResult)
+  PROTECTED
+    sink   : DWScript_Sink;
+    buffer : ARRAY OF AnsiChar;
+    used   : Integer;
+
+  PROTECTED
+    PROCEDURE flush;
+  PUBLIC
+    PROCEDURE AddString(CONST str : UnicodeString); OVERLOAD; OVERRIDE;
+    PROCEDURE AddString(CONST i : Int64); OVERLOAD; OVERRIDE;
+    PROCEDURE AddCRLF; OVERRIDE;
+    PROCEDURE Clear; OVERRIDE;
+  END;
+
+  { a host buffer shared with scripts by ShareArray(), its elements are read and written where they are }
+  DWScript_SharedArrayPtr = ^DWScript_SharedArray;
+  DWScript_SharedArray = RECORD
+    name        : UnicodeString;
+    data        : PByte;
+    count       : Integer;
+    stride      : Integer; //bytes from one element to the next, so a field of an array of structs can be shared too
+    elementType : Integer;
+    readOnly    : Boolean;
+  END;
+  DWScript_SharedArrays = ARRAY OF DWScript_SharedArray;
+
+  { set as the UserObject of every execution the wrapper runs, so host callbacks can reach the counters and sampler of whoever is running them }
+  DWScript_Monitor = CLASS(TObject)
+  PROTECTED
+    sampler        : DWScript_Sampler; //only while the context is being profiled
+    debugger       : IDebugger;        //holds the sampler's reference
+    statistics     : DWScript_Statistics;
+    allocationBase : Integer; //objects the execution had created when last counted
+    started        : Int64;
+    output         : DWScript_Sink; //an execution without one uses its context's, set by SetOutput() under the owning handle's statusLock
+    sink           : DWScript_Sink; //what the run being started writes to, copied from output or the context's as it starts
+    arrays         : DWScript_SharedArrays; //the context's as they were when the run started, this is what the Host* script functions read
+
+  PROTECTED
+    { owner is the handle whose statusLock guards output }
+    PROCEDURE start(owner : DWScript_Object; scriptContext : DWScript_Context; CONST dwsExecution : IdwsProgramExecution);
+    PROCEDURE count(execution : TdwsProgramExecution);
+    { owner is the handle whose statusLock guards statistics, as GetStatistics() reads them from any thread }
+    PROCEDURE finish(owner : DWScript_Object; CONST dwsExecution : IdwsProgramExecution);
+    { adds the statistics of a finished run to these }
+    PROCEDURE merge(CONST run : DWScript_Statistics);
+  END;
+
+  { the script functions reading and writing shared arrays, added to each context's unit as magic functions so their arguments are evaluated as
+    their declared types and elements go straight to and from host memory, with no Variant or TProgramInfo involved }
+  DWScript_HostArrayFunc = CLASS(TInternalMagicIntFunction)
+    FUNCTION DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64; OVERRIDE;
+  END;
+  DWScript_HostLengthFunc = CLASS(TInternalMagicIntFunction)
+    FUNCTION DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64; OVERRIDE;
+  END;
+  DWScript_HostGetIntegerFunc = CLASS(TInternalMagicIntFunction)
+    FUNCTION DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64; OVERRIDE;
+  END;
+  DWScript_HostGetFloatFunc = CLASS(TInternalMagicFloatFunction)
+    PROCEDURE DoEvalAsFloat(CONST args : TExprBaseListExec; VAR Result : Double); OVERRIDE;
+  END;
+  DWScript_HostGetBooleanFunc = CLASS(TInternalMagicBoolFunction)
+    FUNCTION DoEvalAsBoolean(CONST args : TExprBaseListExec) : Boolean; OVERRIDE;
+  END;
+  DWScript_HostSetIntegerFunc = CLASS(TInternalMagicProcedure)
+    PROCEDURE DoEvalProc(CONST args : TExprBaseListExec); OVERRIDE;
+  END;
+  DWScript_HostSetFloatFunc = CLASS(TInternalMagicProcedure)
+    PROCEDURE DoEvalProc(CONST args : TExprBaseListExec); OVERRIDE;
+  END;
+  DWScript_HostSetBooleanFunc = CLASS(TInternalMagicProcedure)
+    PROCEDURE DoEvalProc(CONST args : TExprBaseListExec); OVERRIDE;
+  END;
+
   DWScript_Function = CLASS(TObject)
   PUBLIC
     name           : AnsiString;
+    owner          : DWScript_Context;
     userFunction   : Pointer;
     userData       : Pointer;
     dwsFunction    : TdwsFunction;
     dwsData        : DWScript_Data;
     parameterNames : ARRAY[0..31] OF AnsiString;
+    calls          : Integer; //calls made while being profiled
+    hasJSON        : Boolean; //any JSON parameters need a handle made for them per call
+
+  PROTECTED
+    PROCEDURE wrapper(Info : TProgramInfo);
   END;
 
 TYPE
-  DWScript_Context = CLASS(TObject)
+  DWScript_Context = CLASS(DWScript_Object)
   PROTECTED
     dwsUnit    : TdwsUnit;
     dwsScript  : TDelphiWebScript;
     dwsProgram : IdwsProgram;
+{$ifdef MSWINDOWS}
     dwsAsm     : TdwsAsmLibModule;
-    status     : AnsiString;
+{$endif}
+    dwsJSONLib : TdwsJSONLibModule;
+    signature  : AnsiString; //every function, parameter and return type registered, in order, used to key the program cache
+    profile    : DWScript_Profile; //created by the first SetProfiling()
+    monitor    : DWScript_Monitor; //the totals of every Execute(), each of which has a monitor of its own, guarded by statusLock
+    arrays     : DWScript_SharedArrays; //replaced rather than changed in place, runs keep the one they started with, guarded by statusLock
 {$ifdef FPC}
     functions  : TFPHashList;
 {$else}
@@ -97,13 +391,177 @@ TYPE
 {$endif}
 
   PROTECTED
-    PROCEDURE wrapper(Info : TProgramInfo);
+    FUNCTION profileReport(format : Integer) : String;
+    { adds the Host* functions to the unit's symbols each time they are built }
+    PROCEDURE addHostFunctions(sender : TObject);
+  PUBLIC
+    CONSTRUCTOR Create(flags : Integer);
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+TYPE
+  { a JSON document held by the host, sharing the boxed value a script's JSONVariant holds so neither side copies it }
+  DWScript_JSON = CLASS(DWScript_Object)
+  PROTECTED
+    boxed : IBoxedJSONValue;
+  END;
 
+  { a compiled script, independent of the one compiled into its context with DWScript_compile(),
+    any number of executions can be created from it and run at the same time }
+  DWScript_Program = CLASS(DWScript_Object)
+  PROTECTED
+    context    : DWScript_Context;
+    dwsProgram : IdwsProgram;
+  END;
+
+  DWScript_CacheEntry = CLASS(TObject)
   PUBLIC
-    PROPERTY Message : AnsiString READ status;
+    hash       : Cardinal;
+    key        : AnsiString;
+    context    : DWScript_Context; //the context whose callbacks the program is bound to
+    dwsProgram : IdwsProgram;
+  END;
+
+  { compiled programs held for every context, keyed on the context, the script text, the registered functions and the compile flags.
+    a program calls back into the functions of the context that compiled it, so it is only ever handed back to that context.
+    entries are kept in least recently used order, and evicted from the front once the capacity is reached }
+  DWScript_ProgramCache = CLASS(TObject)
+  PROTECTED
+    entries    : TList;
+    lock       : TFixedCriticalSection;
+    capacity   : Integer;
+    hits       : Integer;
+    misses     : Integer;
+    evictions  : Integer;
+
+  PROTECTED
+    PROCEDURE evict(index : Integer);
   PUBLIC
-    CONSTRUCTOR Create(flags : Integer);
+    CONSTRUCTOR Create;
+    DESTRUCTOR Destroy; OVERRIDE;
+    FUNCTION find(CONST key : AnsiString; context : DWScript_Context; VAR compiled : IdwsProgram) : Boolean;
+    PROCEDURE store(CONST key : AnsiString; context : DWScript_Context; CONST compiled : IdwsProgram);
+    PROCEDURE forget(context : DWScript_Context);
+    PROCEDURE resize(newCapacity : Integer);
+    PROCEDURE getStatistics(VAR statistics : DWScript_CacheStatistics);
+  END;
+
+TYPE
+  DWScript_Job = CLASS;
+
+  { a single execution of a compiled program, owning its own stack and globals.
+    it can be run as many times as you like, but only by one thread at a time }
+  DWScript_Execution = CLASS(DWScript_Object)
+  PROTECTED
+    owner        : DWScript_Program;
+    context      : DWScript_Context;
+    dwsExecution : IdwsProgramExecution;
+    monitor      : DWScript_Monitor;
+    timeout      : Integer; //milliseconds, the program's unless set by SetLimits()
+    pending      : DWScript_Job; //set while queued or running on the worker pool, guarded by the pool lock
+    idle         : TEvent;       //reset while pending is set, so destroying the execution can wait for its job
+    callables    : TList; //functions resolved while begun, these are only valid until the execution ends
+    batchStrings : ARRAY OF AnsiString; //string results of the last InvokeBatch(), valid until the next one
+
+  PROTECTED
+    PROCEDURE releaseCallables;
+  PUBLIC
+    CONSTRUCTOR Create;
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+  { a script function resolved once within a begun execution, so it can be invoked repeatedly without looking it up again }
+  DWScript_Callable = CLASS(TObject)
+  PROTECTED
+    owner      : DWScript_Execution;
+    info       : IInfo;
+    execution  : TdwsProgramExecution;
+    funcSym    : TFuncSymbol;
+    callExpr   : TFuncExpr; //built once when every parameter and the result are simple types, NIL otherwise
+    arguments  : ARRAY OF TConstExpr; //owned by callExpr, their data is overwritten on every call
+    types      : ARRAY OF Integer; //DATATYPE_ of each parameter
+    resultType : Integer;
+
+  PROTECTED
+    PROCEDURE prepare;
+    { whether a value of dataType can be passed as the parameter, integers are accepted for floats and booleans, and UTF-8 for strings }
+    FUNCTION accepts(parameter, dataType : Integer) : Boolean;
+    PROCEDURE setArgument(parameter : Integer; CONST value : DWScript_Variable);
+    { sets the frame level of callExpr, once per trip in from the host }
+    PROCEDURE enter;
+    FUNCTION invoke(data : DWScript_DataPtr) : Boolean;
+  PUBLIC
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+  DWScript_JobState = (jsQueued, jsRunning, jsFinished);
+
+  { a run of an execution submitted to the worker pool, reporting back through its completion callback }
+  DWScript_Job = CLASS(DWScript_Object)
+  PROTECTED
+    execution           : DWScript_Execution;
+    timeoutMilliseconds : Integer;
+    callback            : DWScript_CompletionFunction;
+    userData            : Pointer;
+    state               : DWScript_JobState; //guarded by the pool lock
+    cancelled           : Boolean;           //guarded by the pool lock
+    success             : Boolean;
+    done                : TEvent;
+
+  PROTECTED
+    PROCEDURE run;
+  PUBLIC
+    CONSTRUCTOR Create;
+    DESTRUCTOR Destroy; OVERRIDE;
+  END;
+
+  DWScript_WorkerPool = CLASS;
+
+  DWScript_Worker = CLASS(TdwsThread)
+  PROTECTED
+    pool : DWScript_WorkerPool;
+    job  : DWScript_Job; //the job being run or called back, only touched by the worker itself
+    PROCEDURE Execute; OVERRIDE;
+  END;
+
+  { a plain lock-and-event queue of jobs serviced by a fixed number of threads, started on first use.
+    the engine's IOCP pool in dwsIOCPWorkerThreadPool is Windows only, this is what it would look like without IOCP }
+  DWScript_WorkerPool = CLASS(TObject)
+  PROTECTED
+    lock        : TFixedCriticalSection;
+    wake        : TEvent; //auto-reset, a worker that takes a job passes the signal on if there is more work
+    queue       : TList;
+    head        : Integer; //jobs before this in queue have been taken, they are dropped once they are half of it
+    workers     : TList;
+    workerCount : Integer; //0 picks one per processor when the pool is first used
+    started     : Boolean;
+    stopping    : Boolean;
+    halted      : Boolean; //set by resize(0), jobs are refused until the pool is given workers again
+    busy        : Integer;
+    peakQueued  : Integer;
+    submitted   : Integer;
+    completed   : Integer;
+    cancelled   : Integer;
+
+  PROTECTED
+    PROCEDURE start;
+    PROCEDURE stop;
+    FUNCTION take : DWScript_Job;
+    PROCEDURE finish(job : DWScript_Job);
+    FUNCTION withdraw(job : DWScript_Job) : Boolean;
+    PROCEDURE drain;
+  PUBLIC
+    CONSTRUCTOR Create;
     DESTRUCTOR Destroy; OVERRIDE;
+    FUNCTION submit(job : DWScript_Job) : Boolean;
+    FUNCTION cancel(job : DWScript_Job) : Boolean;
+    { cancels any job of the execution and waits for it, fails if called from that job's own run or callback.
+      a job no worker will reach is finished there and then rather than waited for }
+    FUNCTION release(execution : DWScript_Execution) : Boolean;
+    { fails if called from a worker, which would be waiting for itself to stop.
+      0 cancels everything still queued and refuses new jobs until the pool is given workers again }
+    FUNCTION resize(newCount : Integer) : Boolean;
+    PROCEDURE getStatistics(VAR statistics : DWScript_PoolStatistics);
   END;
 
 FUNCTION DWScript_addFunction(context : pointer; functionName : PAnsiChar; userFunction, userdata : Pointer) : Pointer; stdcall;
@@ -113,384 +571,2792 @@ FUNCTION DWScript_call(context : pointer; state : Pointer; functionName : PAnsiC
 FUNCTION DWScript_callStateless(context : pointer; functionName : PAnsiChar; data : DWScript_DataPtr) : Boolean; stdcall;
 FUNCTION DWScript_compile(context : pointer; scriptText : PAnsiChar; flags : Integer) : Boolean; stdcall;
 FUNCTION DWScript_execute(context : pointer; flags : Integer) : Boolean; stdcall;
+FUNCTION DWScript_createProgram(context : pointer; scriptText : PAnsiChar; flags : Integer) : Pointer; stdcall;
+PROCEDURE DWScript_destroyProgram(programHandle : pointer); stdcall;
+FUNCTION DWScript_createExecution(programHandle : pointer) : Pointer; stdcall;
+PROCEDURE DWScript_destroyExecution(execution : pointer); stdcall;
+FUNCTION DWScript_run(execution : pointer; flags : Integer) : Boolean; stdcall;
+FUNCTION DWScript_beginExecution(execution : pointer; flags : Integer) : Boolean; stdcall;
+PROCEDURE DWScript_endExecution(execution : pointer); stdcall;
+FUNCTION DWScript_findFunction(execution : pointer; functionName : PAnsiChar) : Pointer; stdcall;
+FUNCTION DWScript_invoke(callable : pointer; data : DWScript_DataPtr) : Boolean; stdcall;
+FUNCTION DWScript_invokeBatch(callable : pointer; columns : DWScript_ColumnPtr; columnCount, rowCount : Integer; results : DWScript_ColumnPtr) : Boolean; stdcall;
+PROCEDURE DWScript_setCacheCapacity(capacity : Integer); stdcall;
+FUNCTION DWScript_getCacheStatistics(statistics : DWScript_CacheStatisticsPtr) : Boolean; stdcall;
+FUNCTION DWScript_runAsync(execution : pointer; timeoutMilliseconds : Integer; callback : DWScript_CompletionFunction; userdata : Pointer) : Pointer; stdcall;
+FUNCTION DWScript_cancel(job : pointer) : Boolean; stdcall;
+FUNCTION DWScript_wait(job : pointer; timeoutMilliseconds : Integer) : Boolean; stdcall;
+PROCEDURE DWScript_destroyJob(job : pointer); stdcall;
+FUNCTION DWScript_setWorkerCount(count : Integer) : Boolean; stdcall;
+FUNCTION DWScript_getPoolStatistics(statistics : DWScript_PoolStatisticsPtr) : Boolean; stdcall;
+FUNCTION DWScript_setProfiling(context : pointer; intervalMilliseconds : Integer) : Boolean; stdcall;
+PROCEDURE DWScript_resetProfile(context : pointer); stdcall;
+FUNCTION DWScript_getProfile(context : pointer; format : Integer; buffer : PAnsiChar; size : Integer) : Integer; stdcall;
+FUNCTION DWScript_setLimits(handle : pointer; limits : DWScript_LimitsPtr) : Boolean; stdcall;
+FUNCTION DWScript_getStatistics(handle : pointer; statistics : DWScript_StatisticsPtr; reset : Integer) : Boolean; stdcall;
+FUNCTION DWScript_parseJSON(context : pointer; text : PAnsiChar; length : Integer) : Pointer; stdcall;
+FUNCTION DWScript_getJSON(json : pointer; buffer : PAnsiChar; size : Integer) : Integer; stdcall;
+PROCEDURE DWScript_destroyJSON(json : pointer); stdcall;
+FUNCTION DWScript_setOutput(handle : pointer; callback : DWScript_OutputFunction; userdata : Pointer; bufferSize : Integer) : Boolean; stdcall;
+FUNCTION DWScript_shareArray(context : pointer; name : PAnsiChar; elementType : Integer; data : Pointer; count, stride, readOnly : Integer) : Boolean; stdcall;
 
 IMPLEMENTATION
 
-CONSTRUCTOR DWScript_Context.Create(flags : Integer);
+VAR
+  programCache : DWScript_ProgramCache;
+  workerPool   : DWScript_WorkerPool;
+  samplers     : TList; //every sampler attached to a running execution, ticked by the one clock
+  samplersLock : TFixedCriticalSection;
+  clockRunning : Boolean;
+  outputType   : DWScript_OutputType;
+  textCaches   : TList; //every thread's, freed when unloaded
+  textLock     : TFixedCriticalSection;
+
+THREADVAR
+  startingSink  : DWScript_SinkPtr; //set by DWScript_Monitor.start for the output of the run it is about to start
+  textCache     : DWScript_TextCache;
+  currentWorker : DWScript_Worker; //set on the pool's threads
+
+CONST
+  INTERNED_LENGTH = 32; //longest UTF-8, in bytes, looked up in the text cache
+  RETURN_SLOTS    = 64; //most threads a handle keeps a string result for at once
+
+{ modified FNV-1a using length as seed, as per dwsUtils.SimpleStringHash but over the raw bytes }
+FUNCTION hashKey(CONST key : AnsiString) : Cardinal;
+VAR
+  index : Integer;
 BEGIN
-  dwsScript        := TDelphiWebScript.Create(NIL);
-  dwsUnit          := TdwsUnit.Create(NIL);
-  dwsUnit.UnitName := 'CustomFunctions';
-  dwsUnit.Script   := dwsScript;
-  status           := '';
-{$ifdef FPC}
-  functions        := TFPHashList.Create;
-  //TODO: implement OLE stuff for FPC
-{$else}
-  functions        := TDictionary<AnsiString, Pointer>.Create;
-  IF (flags AND FLAG_OLE <> 0) THEN
-  BEGIN
-    CoInitialize(NIL);
-    com := TdwsComConnector.Create(NIL);
-    com.Script := dwsScript;
+  Result := Length(key);
+  FOR index := 1 TO Length(key) DO
+    Result := (Result XOR Ord(key[index])) * 16777619;
+END;
+
+CONSTRUCTOR DWScript_ProgramCache.Create;
+BEGIN
+  INHERITED;
+  entries  := TList.Create;
+  lock     := TFixedCriticalSection.Create;
+  capacity := 64;
+END;
+
+DESTRUCTOR DWScript_ProgramCache.Destroy;
+BEGIN
+  resize(0);
+  entries.Free;
+  lock.Free;
+  INHERITED;
+END;
+
+PROCEDURE DWScript_ProgramCache.evict(index : Integer);
+BEGIN
+  DWScript_CacheEntry(entries[index]).Free;
+  entries.Delete(index);
+END;
+
+FUNCTION DWScript_ProgramCache.find(CONST key : AnsiString; context : DWScript_Context; VAR compiled : IdwsProgram) : Boolean;
+VAR
+  index : Integer;
+  hash  : Cardinal;
+  entry : DWScript_CacheEntry;
+BEGIN
+  Result := FALSE;
+  hash   := hashKey(key);
+  lock.Enter;
+  TRY
+    FOR index := entries.Count - 1 DOWNTO 0 DO
+    BEGIN
+      entry := DWScript_CacheEntry(entries[index]);
+      IF (entry.hash = hash) AND (entry.context = context) AND (entry.key = key) THEN
+      BEGIN
+        entries.Move(index, entries.Count - 1);
+        compiled := entry.dwsProgram;
+        Inc(hits);
+        Result := TRUE;
+        Exit;
+      END;
+    END;
+    Inc(misses);
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_ProgramCache.store(CONST key : AnsiString; context : DWScript_Context; CONST compiled : IdwsProgram);
+VAR
+  entry : DWScript_CacheEntry;
+BEGIN
+  lock.Enter;
+  TRY
+    IF (capacity <= 0) THEN Exit;
+    WHILE (entries.Count >= capacity) DO
+    BEGIN
+      evict(0);
+      Inc(evictions);
+    END;
+    entry            := DWScript_CacheEntry.Create;
+    entry.hash       := hashKey(key);
+    entry.key        := key;
+    entry.context    := context;
+    entry.dwsProgram := compiled;
+    entries.Add(entry);
+  FINALLY
+    lock.Leave;
   END;
+END;
+
+PROCEDURE DWScript_ProgramCache.forget(context : DWScript_Context);
+VAR
+  index : Integer;
+BEGIN
+  lock.Enter;
+  TRY
+    FOR index := entries.Count - 1 DOWNTO 0 DO
+      IF (DWScript_CacheEntry(entries[index]).context = context) THEN
+        evict(index);
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_ProgramCache.resize(newCapacity : Integer);
+BEGIN
+  lock.Enter;
+  TRY
+    capacity := newCapacity;
+    WHILE (entries.Count > 0) AND (entries.Count > capacity) DO
+    BEGIN
+      evict(0);
+      Inc(evictions);
+    END;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_ProgramCache.getStatistics(VAR statistics : DWScript_CacheStatistics);
+BEGIN
+  lock.Enter;
+  TRY
+    statistics.capacity  := capacity;
+    statistics.count     := entries.Count;
+    statistics.hits      := hits;
+    statistics.misses    := misses;
+    statistics.evictions := evictions;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+{ UTF-8 to UTF-16 in one pass, four ASCII bytes at a time while there are any.
+  malformed sequences become U+FFFD, including overlong ones and encoded surrogates, as RFC 3629 has them }
+FUNCTION decodeUTF8(text : PAnsiChar; length : Integer) : UnicodeString;
+VAR
+  source, stop : PByte;
+  dest         : PWideChar;
+  code, extra  : Cardinal;
+  least        : Cardinal; //the smallest code point the sequence's length may encode
+{$ifdef UNALIGNED_READS}
+  quad         : Cardinal;
 {$endif}
-  IF (flags AND FLAG_ASM <> 0) THEN
+BEGIN
+  Result := '';
+  IF (length <= 0) THEN Exit;
+  SetLength(Result, length); //never more characters than bytes
+  source := PByte(text);
+  stop   := source + length;
+  dest   := PWideChar(Pointer(Result));
+  WHILE (source < stop) DO
   BEGIN
-    dwsAsm := TdwsAsmLibModule.Create(NIL);
-    dwsAsm.Script := dwsScript;
+{$ifdef UNALIGNED_READS}
+    WHILE (stop - source >= 4) AND (PCardinal(source)^ AND $80808080 = 0) DO
+    BEGIN
+      quad := PCardinal(source)^;
+      PCardinal(dest)^     := (quad AND $FF) OR ((quad AND $FF00) SHL 8);
+      PCardinal(dest + 2)^ := ((quad SHR 16) AND $FF) OR ((quad SHR 8) AND $FF0000);
+      Inc(source, 4);
+      Inc(dest, 4);
+    END;
+    IF (source >= stop) THEN Break;
+{$endif}
+    code := source^;
+    Inc(source);
+    IF (code < $80) THEN
+    BEGIN
+      dest^ := WideChar(code);
+      Inc(dest);
+      Continue;
+    END;
+
+    IF (code AND $E0 = $C0) THEN BEGIN extra := 1; code := code AND $1F; least := $80; END
+    ELSE IF (code AND $F0 = $E0) THEN BEGIN extra := 2; code := code AND $0F; least := $800; END
+    ELSE IF (code AND $F8 = $F0) THEN BEGIN extra := 3; code := code AND $07; least := $10000; END
+    ELSE BEGIN extra := 0; code := $FFFD; least := 0; END;
+    WHILE (extra > 0) AND (source < stop) AND (source^ AND $C0 = $80) DO
+    BEGIN
+      code := (code SHL 6) OR (source^ AND $3F);
+      Inc(source);
+      Dec(extra);
+    END;
+    IF (extra > 0) OR (code < least) OR (code > $10FFFF) OR ((code >= $D800) AND (code <= $DFFF)) THEN code := $FFFD;
+
+    IF (code >= $10000) THEN
+    BEGIN
+      Dec(code, $10000);
+      dest^       := WideChar($D800 + (code SHR 10));
+      (dest + 1)^ := WideChar($DC00 + (code AND $3FF));
+      Inc(dest, 2);
+    END
+    ELSE
+    BEGIN
+      dest^ := WideChar(code);
+      Inc(dest);
+    END;
+  END;
+  SetLength(Result, dest - PWideChar(Pointer(Result)));
+END;
+
+{ UTF-16 to NUL terminated UTF-8 in buffer, which only ever grows so a buffer kept between calls stops allocating, returns the length in bytes }
+FUNCTION encodeUTF8(CONST value : UnicodeString; VAR buffer : AnsiString) : Integer;
+BEGIN
+  IF (Length(buffer) < Length(value) * 3 + 1) THEN
+    SetLength(buffer, Length(value) * 3 + 1)
+  ELSE
+    UniqueString(buffer);
+  Result := UTF16ToUTF8Buffer(PWideChar(Pointer(value)), Length(value), PAnsiChar(Pointer(buffer)));
+  buffer[Result + 1] := #0;
+END;
+
+FUNCTION DWScript_TextCache.decode(text : PAnsiChar; length : Integer) : UnicodeString;
+VAR
+  hash  : Cardinal;
+  index : Integer;
+BEGIN
+  hash := length;
+  FOR index := 0 TO length - 1 DO
+    hash := (hash XOR Ord(text[index])) * 16777619;
+  index := (hash XOR (hash SHR 8)) AND High(bytes);
+  IF (System.Length(bytes[index]) = length) AND CompareMem(Pointer(bytes[index]), text, length) THEN
+  BEGIN
+    Result := texts[index];
+    Exit;
+  END;
+  Result := decodeUTF8(text, length);
+  SetString(bytes[index], text, length);
+  texts[index] := Result;
+END;
+
+{ a UTF-8 string from C as the script's UnicodeString, short ones through this thread's text cache }
+FUNCTION textOf(CONST value : DWScript_UTF8) : UnicodeString;
+VAR
+  length : Integer;
+BEGIN
+  Result := '';
+  IF (value.text = NIL) THEN Exit;
+  length := value.length;
+  IF (length < 0) THEN length := StrLen(value.text);
+  IF (length = 0) THEN Exit;
+  IF (length > INTERNED_LENGTH) THEN
+  BEGIN
+    Result := decodeUTF8(value.text, length);
+    Exit;
+  END;
+
+  IF (textCache = NIL) THEN
+  BEGIN
+    textCache := DWScript_TextCache.Create;
+    textLock.Enter;
+    TRY
+      textCaches.Add(textCache);
+    FINALLY
+      textLock.Leave;
+    END;
   END;
+  Result := textCache.decode(value.text, length);
+END;
+
+CONSTRUCTOR DWScript_Object.Create;
+BEGIN
+  INHERITED;
+  statusLock := TFixedCriticalSection.Create;
+  statusText := '';
+END;
+
+DESTRUCTOR DWScript_Object.Destroy;
+BEGIN
+  statusLock.Free;
+  INHERITED;
+END;
+
+FUNCTION DWScript_Object.getStatus : AnsiString;
+BEGIN
+  statusLock.Enter;
+  TRY
+    Result := statusText;
+  FINALLY
+    statusLock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_Object.setStatus(CONST value : AnsiString);
+BEGIN
+  statusLock.Enter;
+  TRY
+    statusText := value;
+  FINALLY
+    statusLock.Leave;
+  END;
+END;
+
+{ the calling thread's entry in returnStrings, made on its first string result, statusLock must be held.
+  threads that come and go would otherwise add entries without end, so past RETURN_SLOTS the least recently used one is taken over }
+FUNCTION DWScript_Object.returnSlot : Integer;
+VAR
+  thread : TThreadID;
+  oldest : Integer;
+BEGIN
+  thread := GetCurrentThreadId;
+  Inc(returnClock);
+  Result := 0;
+  oldest := 0;
+  WHILE (Result < Length(returnStrings)) AND (returnStrings[Result].thread <> thread) DO
+  BEGIN
+    IF (returnClock - returnStrings[Result].used > returnClock - returnStrings[oldest].used) THEN oldest := Result;
+    Inc(Result);
+  END;
+  IF (Result = Length(returnStrings)) THEN
+  BEGIN
+    IF (Result < RETURN_SLOTS) THEN
+      SetLength(returnStrings, Result + 1)
+    ELSE
+      Result := oldest; //its buffers are kept, only the thread changes
+    returnStrings[Result].thread := thread;
+  END;
+  returnStrings[Result].used := returnClock;
+END;
+
+FUNCTION DWScript_Object.keepString(CONST value : UnicodeString) : PAnsiChar;
+VAR
+  converted : AnsiString;
+  index     : Integer;
+BEGIN
+  converted := AnsiString(value);
+  statusLock.Enter;
+  TRY
+    index := returnSlot;
+    returnStrings[index].text := converted;
+    Result := PAnsiChar(returnStrings[index].text);
+  FINALLY
+    statusLock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_Object.keepUTF8(CONST value : UnicodeString; VAR text : DWScript_UTF8);
+VAR
+  index : Integer;
+BEGIN
+  statusLock.Enter;
+  TRY
+    index := returnSlot;
+    text.length := encodeUTF8(value, returnStrings[index].utf8);
+    text.text   := PAnsiChar(returnStrings[index].utf8);
+  FINALLY
+    statusLock.Leave;
+  END;
+END;
+
+{ wraps a JSONVariant coming out of a script into a new handle, the connector keeps immediate values unboxed }
+FUNCTION newJSON(CONST value : Variant) : DWScript_JSON;
+VAR
+  unknown : IUnknown;
+BEGIN
+  Result := DWScript_JSON.Create;
+  IF (VarType(value) = varUnknown) THEN
+  BEGIN
+    unknown      := value;
+    Result.boxed := unknown AS IBoxedJSONValue;
+  END
+  ELSE
+    Result.boxed := BoxedJSONValue(TdwsJSONImmediate.FromVariant(value));
+END;
+
+{ the JSONVariant a script sees for a handle, NIL handles become JSON null }
+FUNCTION jsonVariant(json : Pointer) : Variant;
+BEGIN
+  IF (json = NIL) THEN
+    Result := Null
+  ELSE
+    Result := DWScript_JSON(json).boxed;
+END;
+
+{ maps a script type onto the DATATYPE_ it is exchanged with C as, DATATYPE_NOTSET for no type, or -1 if it cannot be }
+FUNCTION dataTypeOf(typ : TTypeSymbol) : Integer;
+BEGIN
+  IF (typ = NIL) THEN
+    Result := DATATYPE_NOTSET
+  ELSE IF typ.UnAliasedTypeIs(TBaseIntegerSymbol) THEN
+    Result := DATATYPE_INTEGER
+  ELSE IF typ.UnAliasedTypeIs(TBaseFloatSymbol) THEN
+    Result := DATATYPE_FLOAT
+  ELSE IF typ.UnAliasedTypeIs(TBaseBooleanSymbol) THEN
+    Result := DATATYPE_BOOLEAN
+  ELSE IF typ.UnAliasedTypeIs(TBaseStringSymbol) THEN
+    Result := DATATYPE_STRING //or DATATYPE_UTF8, whichever C asks for
+  ELSE IF typ.UnAliasedTypeIs(TJSONConnectorSymbol) THEN
+    Result := DATATYPE_JSON
+  ELSE
+    Result := -1;
+END;
+
+CONSTRUCTOR DWScript_Context.Create(flags : Integer);
+BEGIN
+  INHERITED Create;
+  dwsScript        := TDelphiWebScript.Create(NIL);
+  dwsUnit          := TdwsUnit.Create(NIL);
+  dwsUnit.UnitName := 'CustomFunctions';
+  dwsUnit.Script   := dwsScript;
+  //the symbols of the registered functions are built once and linked into every compile, instead of being rebuilt by each of them
+  dwsUnit.StaticSymbols := TRUE;
+{$ifdef FPC}
+  dwsUnit.OnAfterInitUnitTable := @addHostFunctions;
+{$else}
+  dwsUnit.OnAfterInitUnitTable := addHostFunctions;
+{$endif}
+  monitor          := DWScript_Monitor.Create;
+{$ifdef FPC}
+  functions        := TFPHashList.Create;
+  //TODO: implement OLE stuff for FPC
+{$else}
+  functions        := TDictionary<AnsiString, Pointer>.Create;
+  IF (flags AND FLAG_OLE <> 0) THEN
+  BEGIN
+    CoInitialize(NIL);
+    com := TdwsComConnector.Create(NIL);
+    com.Script := dwsScript;
+  END;
+{$endif}
+  IF (flags AND FLAG_ASM <> 0) THEN
+  BEGIN
+{$ifdef MSWINDOWS}
+    dwsAsm := TdwsAsmLibModule.Create(NIL);
+    dwsAsm.Script := dwsScript;
+{$else}
+    status := 'WARNING: ASM not supported in this build';
+{$endif}
+  END;
+  //always there, as JSON documents can be passed to and from scripts
+  dwsJSONLib        := TdwsJSONLibModule.Create(NIL);
+  dwsJSONLib.Script := dwsScript;
+  dwsScript.Config.ResultType := outputType;
+END;
+
+PROCEDURE DWScript_Context.addHostFunctions(sender : TObject);
+VAR
+  table : TSymbolTable;
+BEGIN
+  //the symbols own the functions, so they go when the unit's symbols are released
+  table := dwsUnit.Table;
+  DWScript_HostArrayFunc.Create(table, 'HostArray', ['name', SYS_STRING], SYS_INTEGER);
+  DWScript_HostLengthFunc.Create(table, 'HostLength', ['handle', SYS_INTEGER], SYS_INTEGER);
+  DWScript_HostGetIntegerFunc.Create(table, 'HostGetInteger', ['handle', SYS_INTEGER, 'index', SYS_INTEGER], SYS_INTEGER);
+  DWScript_HostGetFloatFunc.Create(table, 'HostGetFloat', ['handle', SYS_INTEGER, 'index', SYS_INTEGER], SYS_FLOAT);
+  DWScript_HostGetBooleanFunc.Create(table, 'HostGetBoolean', ['handle', SYS_INTEGER, 'index', SYS_INTEGER], SYS_BOOLEAN);
+  DWScript_HostSetIntegerFunc.Create(table, 'HostSetInteger', ['handle', SYS_INTEGER, 'index', SYS_INTEGER, 'value', SYS_INTEGER], '');
+  DWScript_HostSetFloatFunc.Create(table, 'HostSetFloat', ['handle', SYS_INTEGER, 'index', SYS_INTEGER, 'value', SYS_FLOAT], '');
+  DWScript_HostSetBooleanFunc.Create(table, 'HostSetBoolean', ['handle', SYS_INTEGER, 'index', SYS_INTEGER, 'value', SYS_BOOLEAN], '');
+END;
+
+DESTRUCTOR DWScript_Context.Destroy;
+VAR
+  index       : Integer;
+  dwsFunction : DWScript_Function;
+  p           : Pointer;
+BEGIN
+  programCache.forget(self);
+  //programs compiled here may outlive the context, so unhook the callbacks rather than leave them pointing at freed functions
+{$ifdef FPC}
+  FOR index := 0 TO functions.Count - 1 DO
+  BEGIN
+    dwsFunction := DWScript_Function(functions.Items[index]);
+    dwsFunction.dwsFunction.OnEval := NIL;
+    dwsFunction.Free;
+  END;
+{$else}
+  FOR p IN functions.Values DO
+  BEGIN
+    dwsFunction := DWScript_Function(p);
+    dwsFunction.dwsFunction.OnEval := NIL;
+    dwsFunction.Free;
+  END;
+{$endif}
+  dwsScript.Free;
+  dwsUnit.Free;
+{$ifdef MSWINDOWS}
+  dwsAsm.Free;
+{$endif}
+  dwsJSONLib.Free;
+  functions.Free;
+  profile.Free;
+  monitor.Free;
+{$ifndef FPC}
+  IF (com <> NIL) THEN
+  BEGIN
+    com.Free;
+    CoUninitialize;
+  END;
+{$endif}
+  INHERITED;
+END;
+
+CONSTRUCTOR DWScript_Execution.Create;
+BEGIN
+  INHERITED;
+  callables := TList.Create;
+  monitor   := DWScript_Monitor.Create;
+  idle      := TEvent.Create(NIL, TRUE, TRUE, '');
+END;
+
+DESTRUCTOR DWScript_Execution.Destroy;
+BEGIN
+  releaseCallables;
+  IF (dwsExecution <> NIL) AND (dwsExecution.ProgramState IN [psRunning, psRunningStopped]) THEN
+    dwsExecution.EndProgram;
+  dwsExecution := NIL;
+  callables.Free;
+  monitor.Free;
+  idle.Free;
+  INHERITED;
+END;
+
+PROCEDURE DWScript_Execution.releaseCallables;
+VAR
+  index : Integer;
+BEGIN
+  FOR index := 0 TO callables.Count - 1 DO
+    DWScript_Callable(callables[index]).Free;
+  callables.Clear;
+END;
+
+DESTRUCTOR DWScript_Callable.Destroy;
+BEGIN
+  callExpr.Free;
+  INHERITED;
+END;
+
+{ builds the call expression TInfoFunc.Call would build on every call, once, with constant arguments that get overwritten per call.
+  anything beyond plain functions taking and returning simple values by value is left to the generic doCall() }
+PROCEDURE DWScript_Callable.prepare;
+VAR
+  parameter : Integer;
+  paramSym  : TDataSymbol;
+  expr      : TFuncExprBase;
+BEGIN
+  funcSym    := info.TypeSym.AsFuncSymbol;
+  execution  := owner.dwsExecution.Info.Execution;
+  resultType := dataTypeOf(funcSym.Typ);
+  IF (funcSym IS TMethodSymbol) OR (resultType < 0) OR (resultType = DATATYPE_JSON) OR (funcSym.Params.Count > 32) THEN Exit;
+
+  SetLength(types, funcSym.Params.Count);
+  FOR parameter := 0 TO funcSym.Params.Count - 1 DO
+  BEGIN
+    paramSym := TDataSymbol(funcSym.Params[parameter]);
+    types[parameter] := dataTypeOf(paramSym.Typ);
+    IF (types[parameter] <= DATATYPE_NOTSET) OR (types[parameter] = DATATYPE_JSON) OR (paramSym IS TByRefParamSymbol) OR (paramSym IS TLazyParamSymbol) THEN Exit;
+  END;
+
+  expr := CreateFuncExpr(execution.Prog, funcSym, NIL, NIL);
+  IF NOT (expr IS TFuncExpr) THEN BEGIN expr.Free; Exit; END; //built-in magic functions
+  callExpr := TFuncExpr(expr);
+  SetLength(arguments, funcSym.Params.Count);
+  FOR parameter := 0 TO funcSym.Params.Count - 1 DO
+  BEGIN
+    arguments[parameter] := TConstExpr.Create(execution.Prog, TDataSymbol(funcSym.Params[parameter]).Typ);
+    callExpr.AddArg(arguments[parameter]);
+  END;
+  callExpr.Initialize(execution.Prog);
+END;
+
+FUNCTION DWScript_Callable.accepts(parameter, dataType : Integer) : Boolean;
+BEGIN
+  CASE types[parameter] OF
+    DATATYPE_INTEGER: Result := (dataType = DATATYPE_INTEGER) OR (dataType = DATATYPE_BOOLEAN);
+    DATATYPE_FLOAT:   Result := (dataType = DATATYPE_FLOAT) OR (dataType = DATATYPE_INTEGER);
+    DATATYPE_BOOLEAN: Result := (dataType = DATATYPE_BOOLEAN) OR (dataType = DATATYPE_INTEGER);
+    DATATYPE_STRING:  Result := (dataType = DATATYPE_STRING) OR (dataType = DATATYPE_UTF8);
+  ELSE
+    Result := FALSE;
+  END;
+END;
+
+PROCEDURE DWScript_Callable.setArgument(parameter : Integer; CONST value : DWScript_Variable);
+VAR
+  wideString : UnicodeString;
+BEGIN
+  CASE types[parameter] OF
+    DATATYPE_INTEGER:
+      IF (value.dataType = DATATYPE_BOOLEAN) THEN arguments[parameter].Data[0] := Int64(Ord(value.b))
+      ELSE arguments[parameter].Data[0] := value.i;
+    DATATYPE_FLOAT:
+      IF (value.dataType = DATATYPE_INTEGER) THEN arguments[parameter].Data[0] := Double(value.i)
+      ELSE arguments[parameter].Data[0] := Double(value.f);
+    DATATYPE_BOOLEAN:
+      IF (value.dataType = DATATYPE_INTEGER) THEN arguments[parameter].Data[0] := (value.i <> 0)
+      ELSE arguments[parameter].Data[0] := value.b;
+    DATATYPE_STRING:
+      IF (value.dataType = DATATYPE_UTF8) THEN arguments[parameter].Data[0] := textOf(value.u)
+      ELSE BEGIN wideString := value.s; arguments[parameter].Data[0] := wideString; END;
+  END;
+END;
+
+PROCEDURE DWScript_Callable.enter;
+VAR
+  caller : TExprBase;
+BEGIN
+  //as per TInfoFunc.CreateTempFuncExpr, the frame level depends on whether we are being called from within the script
+  caller := execution.CallStackLastExpr;
+  IF (caller <> NIL) THEN
+  BEGIN
+    callExpr.Level := (caller AS TFuncExpr).Level;
+    IF (callExpr.Level = 0) THEN callExpr.Level := 1;
+  END
+  ELSE
+    callExpr.Level := 0;
+END;
+
+{ the typed path: C values go straight into the argument slots and the result is evaluated as its declared type, no IInfo or Variant array per call }
+FUNCTION DWScript_Callable.invoke(data : DWScript_DataPtr) : Boolean;
+VAR
+  parameter  : Integer;
+  count      : Integer;
+  wideString : UnicodeString;
+BEGIN
+  Result := FALSE;
+  count  := 0;
+  IF (data <> NIL) THEN count := data^.valueCount;
+  IF (count <> Length(arguments)) THEN BEGIN owner.status := 'Invoke() was given ' + IntToStr(count) + ' parameters, the function expects ' + IntToStr(Length(arguments)); Exit; END;
+
+  FOR parameter := 0 TO count - 1 DO
+  BEGIN
+    IF NOT accepts(parameter, data^.value[parameter].dataType) THEN BEGIN owner.status := 'Invoke() parameter ' + IntToStr(parameter) + ' does not match the type the script declares it as'; Exit; END;
+    setArgument(parameter, data^.value[parameter]);
+  END;
+
+  enter;
+  IF (data = NIL) OR (resultType = DATATYPE_NOTSET) THEN
+  BEGIN
+    callExpr.EvalNoResult(execution);
+    IF (data <> NIL) THEN data^.returnValue.dataType := DATATYPE_NOTSET;
+  END
+  ELSE IF (resultType = DATATYPE_STRING) AND (data^.returnValue.dataType = DATATYPE_UTF8) THEN
+  BEGIN
+    callExpr.EvalAsString(execution, wideString);
+    owner.keepUTF8(wideString, data^.returnValue.u);
+  END
+  ELSE
+  BEGIN
+    data^.returnValue.dataType := resultType;
+    CASE resultType OF
+      DATATYPE_INTEGER: data^.returnValue.i := callExpr.EvalAsInteger(execution);
+      DATATYPE_FLOAT:   data^.returnValue.f := callExpr.EvalAsFloat(execution);
+      DATATYPE_BOOLEAN: data^.returnValue.i := Ord(callExpr.EvalAsBoolean(execution));
+      DATATYPE_STRING:  BEGIN callExpr.EvalAsString(execution, wideString); data^.returnValue.s := owner.keepString(wideString); END;
+    END;
+  END;
+  Result := TRUE;
+END;
+
+PROCEDURE DWScript_Function.wrapper(Info : TProgramInfo);
+VAR
+  frame       : DWScript_Data; //per call, so concurrent executions and recursive calls never share arguments
+  strings     : ARRAY[0..31] OF AnsiString;
+  scratch     : ARRAY[0..1023] OF AnsiChar; //UTF-8 parameters that fit go here, so most calls allocate nothing for them
+  scratchUsed : Integer;
+  parameter   : Integer;
+  read        : Integer; //parameters read so far, the JSON handles among them are freed however the call ends
+  basePointer : Integer;
+  address     : Integer;
+  wideString  : UnicodeString;
+  value       : Variant;
+  execution   : TdwsProgramExecution;
+  funcSym     : TFuncSymbol;
+  callback    : DWScript_CallbackFunction;
+  monitor     : DWScript_Monitor;
+  sampler     : DWScript_Sampler;
+BEGIN
+  TRY
+    IF (userFunction = NIL) THEN Exit;
+    //the offsets come from the symbol this call was compiled against, read per call rather than cached here,
+    //as programs compiled at different times can be running on several threads at once and each has its own symbol
+    funcSym := Info.FuncSym;
+
+    frame.context      := owner;
+    frame.state        := info;
+    frame.functionName := dwsData.functionName;
+    frame.returnValue  := dwsData.returnValue;
+    frame.valueCount   := dwsData.valueCount;
+    //a program compiled before the last AddParameter() declares fewer parameters than are registered now
+    IF (funcSym.Params.Count < frame.valueCount) THEN frame.valueCount := funcSym.Params.Count;
+
+    execution   := Info.Execution;
+    basePointer := execution.Stack.BasePointer;
+    scratchUsed := 0;
+    read        := 0;
+    TRY
+      FOR parameter := 0 TO frame.valueCount - 1 DO
+      BEGIN
+        frame.value[parameter] := dwsData.value[parameter];
+        address := TDataSymbol(funcSym.Params[parameter]).StackAddr;
+        CASE frame.value[parameter].dataType OF
+          DATATYPE_INTEGER: frame.value[parameter].i := execution.Stack.ReadIntValue_BaseRelative(address);
+          DATATYPE_FLOAT:   frame.value[parameter].f := execution.Stack.ReadFloatValue_BaseRelative(address);
+          DATATYPE_BOOLEAN: frame.value[parameter].i := Ord(execution.Stack.ReadBoolValue(basePointer + address)); //all of C's int
+          DATATYPE_STRING:
+          BEGIN
+            execution.Stack.ReadStrValue(basePointer + address, wideString);
+            strings[parameter] := wideString;
+            frame.value[parameter].s := PAnsiChar(strings[parameter]);
+          END;
+          DATATYPE_JSON:
+          BEGIN
+            execution.Stack.ReadValue(basePointer + address, value);
+            frame.value[parameter].j := newJSON(value);
+          END;
+          DATATYPE_UTF8:
+          BEGIN
+            execution.Stack.ReadStrValue(basePointer + address, wideString);
+            IF (Length(wideString) * 3 < High(scratch) - scratchUsed) THEN
+            BEGIN
+              frame.value[parameter].u.text   := @scratch[scratchUsed];
+              frame.value[parameter].u.length := UTF16ToUTF8Buffer(PWideChar(Pointer(wideString)), Length(wideString), @scratch[scratchUsed]);
+              scratch[scratchUsed + frame.value[parameter].u.length] := #0;
+              Inc(scratchUsed, frame.value[parameter].u.length + 1);
+            END
+            ELSE
+            BEGIN
+              frame.value[parameter].u.length := encodeUTF8(wideString, strings[parameter]);
+              frame.value[parameter].u.text   := PAnsiChar(strings[parameter]);
+            END;
+          END;
+        END;
+        read := parameter + 1;
+      END;
+
+      sampler := NIL;
+      IF (execution.UserObject IS DWScript_Monitor) THEN
+      BEGIN
+        monitor := DWScript_Monitor(execution.UserObject);
+        Inc(monitor.statistics.hostCallbacks); //a monitor belongs to a single run, so only this thread counts into it
+        sampler := monitor.sampler;
+        IF (sampler <> NIL) THEN
+        BEGIN
+          sampler.collect(''); //anything due so far belongs to the script
+          InterlockedIncrement(calls);
+        END;
+      END;
+
+      callback := DWScript_CallbackFunction(userFunction);
+      callback(@frame, userData);
+      IF (sampler <> NIL) THEN sampler.collect(name);
+
+      IF (funcSym.Result = NIL) THEN Exit;
+      //the callback may have called back into the script, which can move the base pointer
+      address := execution.Stack.BasePointer + funcSym.Result.StackAddr;
+      CASE frame.returnValue.dataType OF
+        DATATYPE_INTEGER: execution.Stack.WriteIntValue(address, frame.returnValue.i);
+        DATATYPE_FLOAT:   execution.Stack.WriteFloatValue(address, frame.returnValue.f);
+        DATATYPE_BOOLEAN: execution.Stack.WriteBoolValue(address, frame.returnValue.b);
+        DATATYPE_STRING:  execution.Stack.WriteStrValue(address, UnicodeString(AnsiString(frame.returnValue.s)));
+        DATATYPE_JSON:    execution.Stack.WriteValue(address, jsonVariant(frame.returnValue.j));
+        DATATYPE_UTF8:    execution.Stack.WriteStrValue(address, textOf(frame.returnValue.u));
+      END;
+    FINALLY
+      //the handles made for JSON parameters only last as long as the callback, the documents themselves live on in the script
+      IF hasJSON THEN
+        FOR parameter := 0 TO read - 1 DO
+          IF (frame.value[parameter].dataType = DATATYPE_JSON) THEN DWScript_JSON(frame.value[parameter].j).Free;
+    END;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      owner.status := 'EXCEPTION (Calling "' + name + '"): ' + E.ClassName + ': ' + E.Message;
+      //need to figure out how to propogate this error
+      Exit;
+    END;
+  END;
+END;
+
+
+
+
+FUNCTION DWScript_addParameter(context : pointer; dwsFunctionPtr : Pointer; parameterName : PAnsiChar; dataType : Integer) : Boolean; STDCALL;
+VAR
+  parameter : TdwsParameter;
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+
+  scriptContext.status := '';
+  IF (dwsFunctionPtr = NIL) THEN BEGIN scriptContext.status := 'AddParameter() cannot accept a NULL Function parameter'; Exit; END;
+  IF (parameterName = NIL) OR (Length(parameterName) = 0) THEN BEGIN   scriptContext.status := 'AddParameter() cannot accept a NULL or empty parameter name'; Exit; END;
+
+  WITH DWScript_Function(dwsFunctionPtr) DO
+  BEGIN
+    parameter := dwsFunction.Parameters.Add;
+    parameter.Name := parameterName;
+
+    parameterNames[dwsData.valueCount] := parameterName;
+    dwsData.value[dwsData.valueCount].dataType := dataType;
+    dwsData.value[dwsData.valueCount].name := PAnsiChar(parameterNames[dwsData.valueCount]);
+    CASE dataType OF
+      DATATYPE_INTEGER: parameter.DataType := 'Integer';
+      DATATYPE_FLOAT:   parameter.DataType := 'Float';
+      DATATYPE_BOOLEAN: parameter.DataType := 'Boolean';
+      DATATYPE_STRING:  parameter.DataType := 'String';
+      DATATYPE_JSON:    BEGIN parameter.DataType := 'JSONVariant'; hasJSON := TRUE; END;
+      DATATYPE_UTF8:    parameter.DataType := 'String';
+    ELSE
+      BEGIN scriptContext.status := 'AddParameter() Invalid data type specified'; Exit; END;
+    END;
+
+    dwsData.valueCount := dwsData.valueCount + 1;
+  END;
+  scriptContext.signature := scriptContext.signature + '(' + parameterName + ':' + IntToStr(dataType);
+  scriptContext.dwsUnit.ReleaseStaticSymbols; //rebuilt by the next compile, programs already compiled keep the symbols they were linked to
+
+  Result := TRUE;
+END;
+
+FUNCTION DWScript_setReturnType(context : pointer; dwsFunctionPtr : Pointer; dataType : Integer) : Boolean; STDCALL;
+VAR
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+
+  scriptContext.status := '';
+  IF (dwsFunctionPtr = NIL) THEN BEGIN scriptContext.status := 'SetReturnType() cannot accept a NULL Function parameter'; Exit; END;
+
+  WITH DWScript_Function(dwsFunctionPtr) DO
+  BEGIN
+    dwsData.returnValue.dataType := dataType;
+    CASE dataType OF
+      DATATYPE_INTEGER: dwsFunction.ResultType := 'Integer';
+      DATATYPE_FLOAT:   dwsFunction.ResultType := 'Float';
+      DATATYPE_BOOLEAN: dwsFunction.ResultType := 'Boolean';
+      DATATYPE_STRING:  dwsFunction.ResultType := 'String';
+      DATATYPE_JSON:    dwsFunction.ResultType := 'JSONVariant';
+      DATATYPE_UTF8:    dwsFunction.ResultType := 'String';
+    ELSE
+      BEGIN scriptContext.status := 'SetReturnType() Invalid data type specified'; Exit; END;
+    END;
+  END;
+  scriptContext.signature := scriptContext.signature + '=' + IntToStr(dataType);
+  scriptContext.dwsUnit.ReleaseStaticSymbols;
+  Result := TRUE;
+END;
+
+FUNCTION DWScript_addFunction(context : pointer; functionName : PAnsiChar; userFunction, userData : Pointer) : Pointer; STDCALL;
+VAR
+  newFunction : DWScript_Function;
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := NIL;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+
+  scriptContext.status := '';
+  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'AddFunction() cannot accept a NULL or empty function name'; Exit; END;
+  IF (userFunction = NIL) THEN BEGIN scriptContext.status := 'AddFunction() cannot accept a NULL Callback parameter'; Exit; END;
+{$ifdef FPC} //using the FPHashList for now, which uses ShortStrings as keys, hence this restriction
+  IF (Length(functionName) > 255) THEN BEGIN scriptContext.status := 'AddFunction() Function name must be less than 256 characters in length'; Exit; END;
+{$endif};
+
+  newFunction := DWScript_Function.Create;
+  WITH newFunction DO
+  BEGIN
+    dwsFunction            := scriptContext.dwsUnit.Functions.Add;
+    dwsFunction.Name       := functionName;
+    name                   := functionName;
+    owner                  := scriptContext;
+    dwsData.valueCount     := 0;
+    dwsData.functionName   := PAnsiChar(name);
+    dwsData.state          := NIL;
+{$ifdef FPC}
+    dwsFunction.OnEval     := @newFunction.wrapper;
+{$else}
+    dwsFunction.OnEval     := newFunction.wrapper;
+{$endif}
+  END;
+  newFunction.userFunction := userFunction; //do this here because of naming clashes, TODO: make more sane variable names
+  newFunction.userData     := userData;
+  scriptContext.functions.Add(functionName, newFunction);
+  //the callback and its userdata are part of the key, as a cached program keeps calling the functions it was compiled against
+  scriptContext.signature := scriptContext.signature + #10 + functionName + '@' + IntToHex(NativeUInt(userFunction), 16) + ':' + IntToHex(NativeUInt(userData), 16);
+  scriptContext.dwsUnit.ReleaseStaticSymbols;
+  Result := newFunction;
+END;
+
+FUNCTION doCall(owner : DWScript_Object; Info : IInfo; data : DWScript_DataPtr) : Boolean;
+VAR
+  parameters  : ARRAY[0..31] OF Variant; //fixed, the Variants themselves only touch the heap for strings
+  count       : Integer;
+  index       : Integer;
+  returnValue : IInfo;
+  funcSym     : TFuncSymbol;
+  wideString  : UnicodeString;
+  wantUTF8    : Boolean;
+BEGIN
+  Result := TRUE;
+  TRY
+    //set up any required parameters
+    count := 0;
+    IF (data <> NIL) THEN
+    BEGIN
+      count := data^.valueCount;
+      FOR index := 0 TO count-1 DO
+      BEGIN
+        CASE data^.value[index].dataType OF
+          DATATYPE_INTEGER: parameters[index] := data^.value[index].i;
+          DATATYPE_FLOAT:   parameters[index] := data^.value[index].f;
+          DATATYPE_BOOLEAN: parameters[index] := data^.value[index].b;
+          DATATYPE_STRING:  BEGIN wideString := data^.value[index].s; parameters[index] := wideString; END;
+          DATATYPE_JSON:    parameters[index] := jsonVariant(data^.value[index].j);
+          DATATYPE_UTF8:    parameters[index] := textOf(data^.value[index].u);
+        END;
+      END;
+    END;
+    //call the function
+    IF (count = 0) THEN
+      returnValue := Info.Call([])
+    ELSE
+      returnValue := Info.Call(Slice(parameters, count));
+    //store its return value if required, as the type the script declares rather than whatever Variant it happens to come back as
+    IF (data <> NIL) THEN
+    BEGIN
+      funcSym  := Info.TypeSym.AsFuncSymbol;
+      wantUTF8 := (data^.returnValue.dataType = DATATYPE_UTF8);
+      data^.returnValue.dataType := dataTypeOf(funcSym.Typ);
+      IF wantUTF8 AND (data^.returnValue.dataType = DATATYPE_STRING) THEN data^.returnValue.dataType := DATATYPE_UTF8;
+      CASE data^.returnValue.dataType OF
+        DATATYPE_NOTSET:  ;
+        DATATYPE_INTEGER: data^.returnValue.i := returnValue.ValueAsInteger;
+        DATATYPE_FLOAT:   data^.returnValue.f := returnValue.ValueAsFloat;
+        DATATYPE_BOOLEAN: data^.returnValue.i := Ord(returnValue.ValueAsBoolean);
+        DATATYPE_STRING:  data^.returnValue.s := owner.keepString(returnValue.ValueAsString);
+        DATATYPE_JSON:    data^.returnValue.j := newJSON(returnValue.Value);
+        DATATYPE_UTF8:    owner.keepUTF8(returnValue.ValueAsString, data^.returnValue.u);
+        ELSE
+          BEGIN data^.returnValue.dataType := DATATYPE_NOTSET; owner.status := 'Unhandled script return type'; Result := FALSE; END;
+      END;
+    END;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      owner.status := 'EXCEPTION (Calling function) : ' + E.ClassName + ': ' + E.Message;
+      Result := FALSE;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_call(context : pointer; state : Pointer; functionName : PAnsiChar; data : DWScript_DataPtr) : Boolean; STDCALL;
+VAR
+  info : TProgramInfo;
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+  scriptContext.status := '';
+  IF (state = NIL) THEN BEGIN scriptContext.status := 'Call() cannot accept a NULL State parameter'; Exit; END;
+  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'Call() cannot accept a NULL or empty function name'; Exit; END;
+  //data can be NULL, simply calls the function without parameters and without storing result
+
+  TRY
+    info := TProgramInfo(state);
+    Result := doCall(scriptContext, info.Execution.ProgramInfo.Func[functionName], data);
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptContext.status := 'EXCEPTION (Call("' + functionName + '"): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_callStateless(context : pointer; functionName : PAnsiChar; data : DWScript_DataPtr) : Boolean; STDCALL;
+VAR
+  execution : IdwsProgramExecution;
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+  scriptContext.status := '';
+  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'CallStateless() cannot accept a NULL or empty function name'; Exit; END;
+  //data can be NULL, simply calls the function without parameters and without storing result
+
+  TRY
+    execution := scriptContext.dwsProgram.CreateNewExecution;
+    Result := doCall(scriptContext, execution.Info.Func[functionName], data);
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptContext.status := 'EXCEPTION (CallStateless("' + functionName + '"): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+{ hands whatever output is still buffered to the sink, called whenever a run or a call returns to the host }
+PROCEDURE flushOutput(CONST dwsExecution : IdwsProgramExecution);
+BEGIN
+  IF (dwsExecution.Result IS DWScript_Output) THEN DWScript_Output(dwsExecution.Result).flush;
+END;
+
+{ attaches the monitor to an execution about to start, with a sampler if its context is being profiled, or without the one left from an earlier run if not }
+PROCEDURE DWScript_Monitor.start(owner : DWScript_Object; scriptContext : DWScript_Context; CONST dwsExecution : IdwsProgramExecution);
+BEGIN
+  IF (scriptContext.profile <> NIL) AND scriptContext.profile.enabled THEN
+  BEGIN
+    IF (sampler = NIL) THEN
+    BEGIN
+      sampler         := DWScript_Sampler.Create;
+      sampler.profile := scriptContext.profile;
+      debugger        := sampler;
+    END;
+  END
+  ELSE IF (sampler <> NIL) THEN
+  BEGIN
+    sampler  := NIL;
+    debugger := NIL;
+  END;
+  dwsExecution.Debugger   := debugger;
+  dwsExecution.UserObject := self;
+  //SetOutput() can be called from any thread, so the run takes a copy of the sink as it starts
+  owner.statusLock.Enter;
+  TRY
+    sink := output;
+  FINALLY
+    owner.statusLock.Leave;
+  END;
+  scriptContext.statusLock.Enter;
+  TRY
+    IF NOT Assigned(sink.callback) THEN sink := scriptContext.monitor.output;
+    arrays := scriptContext.arrays;
+  FINALLY
+    scriptContext.statusLock.Leave;
+  END;
+  //the engine creates the run's output only once it begins, on this thread
+  startingSink := @sink;
+  started := GetSystemMilliseconds;
+END;
+
+{ the execution's object count and stack only ever grow, so they are folded in whenever it is convenient rather than tracked }
+PROCEDURE DWScript_Monitor.count(execution : TdwsProgramExecution);
+VAR
+  stackBytes : Integer;
+BEGIN
+  Inc(statistics.allocations, execution.ObjectsCreated - allocationBase);
+  allocationBase := execution.ObjectsCreated;
+  stackBytes := Length(execution.Stack.Data) * SizeOf(Variant);
+  IF (stackBytes > statistics.peakStackBytes) THEN statistics.peakStackBytes := stackBytes;
+END;
+
+PROCEDURE DWScript_Monitor.finish(owner : DWScript_Object; CONST dwsExecution : IdwsProgramExecution);
+VAR
+  elapsed  : Integer;
+  timedOut : Boolean;
+BEGIN
+  elapsed  := GetSystemMilliseconds - started;
+  //the guardian thread stops a script that runs out of time, nothing else in the wrapper does
+  timedOut := dwsExecution.Msgs.HasErrors AND (Pos(RTE_ScriptStopped, dwsExecution.Msgs.AsInfo) > 0);
+  owner.statusLock.Enter;
+  TRY
+    Inc(statistics.runs);
+    Inc(statistics.wallMilliseconds, elapsed);
+    statistics.lastMilliseconds := elapsed;
+    IF timedOut THEN Inc(statistics.timeouts);
+    count(dwsExecution.ExecutionObject AS TdwsProgramExecution);
+  FINALLY
+    owner.statusLock.Leave;
+  END;
+  startingSink := NIL; //in case the run failed before it began
+  flushOutput(dwsExecution);
+END;
+
+PROCEDURE DWScript_Monitor.merge(CONST run : DWScript_Statistics);
+BEGIN
+  Inc(statistics.runs, run.runs);
+  Inc(statistics.timeouts, run.timeouts);
+  Inc(statistics.wallMilliseconds, run.wallMilliseconds);
+  statistics.lastMilliseconds := run.lastMilliseconds;
+  Inc(statistics.hostCallbacks, run.hostCallbacks);
+  Inc(statistics.allocations, run.allocations);
+  IF (run.peakStackBytes > statistics.peakStackBytes) THEN statistics.peakStackBytes := run.peakStackBytes;
+END;
+
+{ the shared array a Host* script function's first argument refers to, for the run calling it }
+FUNCTION sharedArray(CONST args : TExprBaseListExec) : DWScript_SharedArrayPtr;
+VAR
+  monitor : TObject;
+  handle  : Int64;
+BEGIN
+  monitor := args.Exec.UserObject;
+  IF NOT (monitor IS DWScript_Monitor) THEN RAISE Exception.Create('Host arrays are only available to scripts run by the wrapper');
+  handle := args.AsInteger[0];
+  IF (handle < 0) OR (handle >= Length(DWScript_Monitor(monitor).arrays)) THEN RAISE Exception.CreateFmt('Invalid host array %d', [handle]);
+  Result := @DWScript_Monitor(monitor).arrays[handle];
+END;
+
+{ the address of the element a Host* script function's second argument refers to, with the same bounds checks as a script array }
+FUNCTION sharedElement(CONST args : TExprBaseListExec; forWriting : Boolean; VAR shared : DWScript_SharedArrayPtr) : PByte;
+VAR
+  index : Int64;
+BEGIN
+  shared := sharedArray(args);
+  index  := args.AsInteger[1];
+  IF (index < 0) THEN RAISE EScriptOutOfBounds.CreateFmt(RTE_ArrayLowerBoundExceeded, [index]);
+  IF (index >= shared^.count) THEN RAISE EScriptOutOfBounds.CreateFmt(RTE_ArrayUpperBoundExceeded, [index]);
+  IF forWriting AND shared^.readOnly THEN RAISE Exception.CreateFmt('Host array "%s" is read only', [shared^.name]);
+  Result := shared^.data + NativeInt(index) * shared^.stride;
+END;
+
+FUNCTION DWScript_HostArrayFunc.DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64;
+VAR
+  monitor : TObject;
+  name    : UnicodeString;
+  index   : Integer;
+BEGIN
+  monitor := args.Exec.UserObject;
+  IF NOT (monitor IS DWScript_Monitor) THEN RAISE Exception.Create('Host arrays are only available to scripts run by the wrapper');
+  name := args.AsString[0];
+  FOR index := 0 TO High(DWScript_Monitor(monitor).arrays) DO
+    IF UnicodeSameText(DWScript_Monitor(monitor).arrays[index].name, name) THEN Exit(index);
+  RAISE Exception.CreateFmt('No host array is shared as "%s"', [name]);
+END;
+
+FUNCTION DWScript_HostLengthFunc.DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64;
+BEGIN
+  Result := sharedArray(args)^.count;
+END;
+
+FUNCTION DWScript_HostGetIntegerFunc.DoEvalAsInteger(CONST args : TExprBaseListExec) : Int64;
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+BEGIN
+  element := sharedElement(args, FALSE, shared);
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   Result := PInteger(element)^;
+    ELEMENT_INT64:   Result := PInt64(element)^;
+    ELEMENT_FLOAT:   Result := Round(PSingle(element)^);
+    ELEMENT_DOUBLE:  Result := Round(PDouble(element)^);
+  ELSE
+    Result := element^;
+  END;
+END;
+
+PROCEDURE DWScript_HostGetFloatFunc.DoEvalAsFloat(CONST args : TExprBaseListExec; VAR Result : Double);
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+BEGIN
+  element := sharedElement(args, FALSE, shared);
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   Result := PInteger(element)^;
+    ELEMENT_INT64:   Result := PInt64(element)^;
+    ELEMENT_FLOAT:   Result := PSingle(element)^;
+    ELEMENT_DOUBLE:  Result := PDouble(element)^;
+  ELSE
+    Result := element^;
+  END;
+END;
+
+FUNCTION DWScript_HostGetBooleanFunc.DoEvalAsBoolean(CONST args : TExprBaseListExec) : Boolean;
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+BEGIN
+  element := sharedElement(args, FALSE, shared);
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   Result := (PInteger(element)^ <> 0);
+    ELEMENT_INT64:   Result := (PInt64(element)^ <> 0);
+    ELEMENT_FLOAT:   Result := (PSingle(element)^ <> 0);
+    ELEMENT_DOUBLE:  Result := (PDouble(element)^ <> 0);
+  ELSE
+    Result := (element^ <> 0);
+  END;
+END;
+
+PROCEDURE DWScript_HostSetIntegerFunc.DoEvalProc(CONST args : TExprBaseListExec);
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+  value   : Int64;
+BEGIN
+  element := sharedElement(args, TRUE, shared);
+  value   := args.AsInteger[2];
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   PInteger(element)^ := value;
+    ELEMENT_INT64:   PInt64(element)^ := value;
+    ELEMENT_FLOAT:   PSingle(element)^ := value;
+    ELEMENT_DOUBLE:  PDouble(element)^ := value;
+  ELSE
+    element^ := Ord(value <> 0);
+  END;
+END;
+
+PROCEDURE DWScript_HostSetFloatFunc.DoEvalProc(CONST args : TExprBaseListExec);
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+  value   : Double;
+BEGIN
+  element := sharedElement(args, TRUE, shared);
+  value   := args.AsFloat[2];
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   PInteger(element)^ := Round(value);
+    ELEMENT_INT64:   PInt64(element)^ := Round(value);
+    ELEMENT_FLOAT:   PSingle(element)^ := value;
+    ELEMENT_DOUBLE:  PDouble(element)^ := value;
+  ELSE
+    element^ := Ord(value <> 0);
+  END;
+END;
+
+PROCEDURE DWScript_HostSetBooleanFunc.DoEvalProc(CONST args : TExprBaseListExec);
+VAR
+  shared  : DWScript_SharedArrayPtr;
+  element : PByte;
+  value   : Boolean;
+BEGIN
+  element := sharedElement(args, TRUE, shared);
+  value   := args.AsBoolean[2];
+  CASE shared^.elementType OF
+    ELEMENT_INT32:   PInteger(element)^ := Ord(value);
+    ELEMENT_INT64:   PInt64(element)^ := Ord(value);
+    ELEMENT_FLOAT:   PSingle(element)^ := Ord(value);
+    ELEMENT_DOUBLE:  PDouble(element)^ := Ord(value);
+  ELSE
+    element^ := Ord(value);
+  END;
+END;
+
+FUNCTION DWScript_OutputType.CreateProgResult : TdwsResult;
+VAR
+  output : DWScript_Output;
+BEGIN
+  output := DWScript_Output.Create(self);
+  IF (startingSink <> NIL) THEN
+  BEGIN
+    output.sink  := startingSink^;
+    startingSink := NIL;
+    IF Assigned(output.sink.callback) THEN SetLength(output.buffer, output.sink.size);
+  END;
+  Result := output;
+END;
+
+PROCEDURE DWScript_Output.flush;
+BEGIN
+  IF (used = 0) THEN Exit;
+  sink.callback(@buffer[0], used, sink.userData);
+  used := 0;
+END;
+
+PROCEDURE DWScript_Output.AddString(CONST str : UnicodeString);
+VAR
+  index, count : Integer;
+  code         : Integer;
+BEGIN
+  IF NOT Assigned(sink.callback) THEN BEGIN INHERITED AddString(str); Exit; END;
+
+  //encoded straight into the buffer a piece at a time, each piece being as many characters as are sure to fit
+  index := 0;
+  WHILE (index < Length(str)) DO
+  BEGIN
+    count := (Length(buffer) - used) DIV 3;
+    IF (count < 2) THEN BEGIN flush; Continue; END;
+    IF (count >= Length(str) - index) THEN
+      count := Length(str) - index
+    ELSE
+    BEGIN
+      //a surrogate pair is never split between two pieces, so a character is never split between two chunks
+      code := Ord(str[index + count]);
+      IF (code >= $D800) AND (code <= $DBFF) THEN Dec(count);
+    END;
+    Inc(used, UTF16ToUTF8Buffer(PWideChar(Pointer(str)) + index, count, @buffer[used]));
+    Inc(index, count);
+  END;
+END;
+
+PROCEDURE DWScript_Output.AddString(CONST i : Int64);
+BEGIN
+  IF Assigned(sink.callback) THEN AddString(UnicodeString(IntToStr(i))) ELSE INHERITED AddString(i);
+END;
+
+PROCEDURE DWScript_Output.AddCRLF;
+BEGIN
+  IF Assigned(sink.callback) THEN AddString(UnicodeString(#13#10)) ELSE INHERITED AddCRLF;
+END;
+
+PROCEDURE DWScript_Output.Clear;
+BEGIN
+  used := 0; //anything already handed over stays with the host
+  INHERITED Clear;
+END;
+
+FUNCTION compileScript(scriptContext : DWScript_Context; scriptText : PAnsiChar; flags : Integer; VAR compiled : IdwsProgram) : Boolean;
+VAR
+{$ifdef JITTER}
+  jitter : TdwsJITx86;
+{$endif}
+  cacheKey : AnsiString;
+BEGIN
+  Result := FALSE;
+  TRY
+    IF (flags AND FLAG_CACHE <> 0) THEN
+    BEGIN
+      //the limits set on the context are compiled into the program, so they are part of what makes it the same
+      WITH scriptContext.dwsScript.Config DO
+        cacheKey := IntToStr(flags) + #0 + IntToStr(TimeoutMilliseconds) + ',' + IntToStr(MaxRecursionDepth) + ',' + IntToStr(MaxDataSize) + ',' + IntToStr(StackChunkSize)
+                  + #0 + scriptContext.signature + #0 + scriptText;
+      IF programCache.find(cacheKey, scriptContext, compiled) THEN
+      BEGIN
+        Result := TRUE;
+        Exit;
+      END;
+    END;
+
+    compiled := scriptContext.dwsScript.Compile(scriptText);
+    IF compiled.Msgs.Count > 0 THEN
+    BEGIN
+      scriptContext.status := compiled.Msgs.AsInfo
+    END ELSE
+    BEGIN
+      {$ifdef JITTER}
+      IF (flags AND FLAG_JITTER <> 0) THEN
+      BEGIN
+        jitter := TdwsJITx86.Create;
+        jitter.Options := jitter.Options-[jitoNoBranchAlignment];
+        jitter.GreedyJIT(compiled.ProgramObject);
+        jitter.Free;
+      END;
+      {$else}
+      IF (flags AND FLAG_JITTER <> 0) THEN scriptContext.status := 'WARNING: Jitter not supported in this build';
+      {$endif}
+      IF (flags AND FLAG_CACHE <> 0) THEN programCache.store(cacheKey, scriptContext, compiled);
+      Result := True;
+    END;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptContext.status := scriptContext.status + 'EXCEPTION (Compile()): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_compile(context : pointer; scriptText : PAnsiChar; flags : Integer) : Boolean; STDCALL;
+VAR
+  scriptContext : DWScript_Context;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+  scriptContext.status := '';
+  IF (scriptText = NIL) OR (Length(scriptText) = 0) THEN BEGIN scriptContext.status := 'Compile() cannot accept a NULL or empty Script parameter'; Exit; END;
+
+  Result := compileScript(scriptContext, scriptText, flags, scriptContext.dwsProgram);
+END;
+
+FUNCTION DWScript_execute(context : pointer; flags : Integer) : Boolean; STDCALL;
+VAR
+  scriptContext : DWScript_Context;
+  execution     : IdwsProgramExecution;
+  monitor       : DWScript_Monitor;
+BEGIN
+  Result := FALSE;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+  //several threads can be executing the context's program at once, so each run counts and samples on its own and adds its totals to the context's once it is done
+  monitor := DWScript_Monitor.Create;
+  TRY
+    TRY
+      scriptContext.status := '';
+      execution := scriptContext.dwsProgram.CreateNewExecution;
+      monitor.start(scriptContext, scriptContext, execution);
+      execution.Execute;
+      monitor.finish(scriptContext, execution);
+      scriptContext.statusLock.Enter;
+      TRY
+        scriptContext.monitor.merge(monitor.statistics);
+      FINALLY
+        scriptContext.statusLock.Leave;
+      END;
+      IF execution.Msgs.HasErrors THEN
+      BEGIN
+        scriptContext.status := execution.Msgs.AsInfo;
+        Exit;
+      END;
+      scriptContext.status := 'Finished executing';
+      Result := TRUE;
+    EXCEPT
+      ON E: Exception DO
+      BEGIN
+        scriptContext.status := 'EXCEPTION (Run): ' + E.ClassName + ': ' + E.Message;
+      END;
+    END;
+  FINALLY
+    execution := NIL; //it refers to the monitor as its UserObject
+    monitor.Free;
+  END;
+END;
+
+FUNCTION DWScript_createProgram(context : pointer; scriptText : PAnsiChar; flags : Integer) : Pointer; STDCALL;
+VAR
+  scriptContext : DWScript_Context;
+  compiled      : IdwsProgram;
+  newProgram    : DWScript_Program;
+BEGIN
+  Result := NIL;
+  IF (context = NIL) THEN Exit;
+
+  scriptContext := DWScript_Context(context);
+  scriptContext.status := '';
+  IF (scriptText = NIL) OR (Length(scriptText) = 0) THEN BEGIN scriptContext.status := 'CreateProgram() cannot accept a NULL or empty Script parameter'; Exit; END;
+
+  IF NOT compileScript(scriptContext, scriptText, flags, compiled) THEN Exit;
+
+  newProgram            := DWScript_Program.Create;
+  newProgram.context    := scriptContext;
+  newProgram.dwsProgram := compiled;
+  Result := newProgram;
+END;
+
+PROCEDURE DWScript_destroyProgram(programHandle : pointer); STDCALL;
+BEGIN
+  IF (programHandle = NIL) THEN Exit;
+  //any executions still alive keep their own reference to the compiled program
+  DWScript_Program(programHandle).Free;
+END;
+
+FUNCTION DWScript_createExecution(programHandle : pointer) : Pointer; STDCALL;
+VAR
+  scriptProgram : DWScript_Program;
+  newExecution  : DWScript_Execution;
+BEGIN
+  Result := NIL;
+  IF (programHandle = NIL) THEN Exit;
+
+  scriptProgram := DWScript_Program(programHandle);
+  scriptProgram.status := '';
+  TRY
+    newExecution              := DWScript_Execution.Create;
+    newExecution.owner        := scriptProgram;
+    newExecution.context      := scriptProgram.context;
+    newExecution.dwsExecution := scriptProgram.dwsProgram.CreateNewExecution;
+    newExecution.timeout      := scriptProgram.dwsProgram.ProgramObject.TimeoutMilliseconds;
+    Result := newExecution;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptProgram.status := 'EXCEPTION (CreateExecution()): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+PROCEDURE DWScript_destroyExecution(execution : pointer); STDCALL;
+BEGIN
+  IF (execution = NIL) THEN Exit;
+  //a job of it may still be queued or running, and holds on to it until the job finishes
+  IF NOT workerPool.release(DWScript_Execution(execution)) THEN
+  BEGIN
+    DWScript_Execution(execution).status := 'DestroyExecution() cannot destroy an execution from within its own asynchronous run';
+    Exit;
+  END;
+  DWScript_Execution(execution).Free;
+END;
+
+FUNCTION runExecution(scriptExecution : DWScript_Execution; timeoutMilliseconds : Integer) : Boolean;
+BEGIN
+  Result := FALSE;
+  TRY
+    scriptExecution.status := '';
+    IF (timeoutMilliseconds = 0) THEN timeoutMilliseconds := scriptExecution.timeout;
+    scriptExecution.monitor.start(scriptExecution, scriptExecution.context, scriptExecution.dwsExecution);
+    scriptExecution.dwsExecution.Execute(timeoutMilliseconds);
+    scriptExecution.monitor.finish(scriptExecution, scriptExecution.dwsExecution);
+    IF scriptExecution.dwsExecution.Msgs.HasErrors THEN
+    BEGIN
+      scriptExecution.status := scriptExecution.dwsExecution.Msgs.AsInfo;
+      Exit;
+    END;
+    scriptExecution.status := 'Finished executing';
+    Result := TRUE;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptExecution.status := 'EXCEPTION (Run): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_run(execution : pointer; flags : Integer) : Boolean; STDCALL;
+BEGIN
+  Result := FALSE;
+  IF (execution = NIL) THEN Exit;
+  Result := runExecution(DWScript_Execution(execution), 0);
+END;
+
+FUNCTION DWScript_beginExecution(execution : pointer; flags : Integer) : Boolean; STDCALL;
+VAR
+  scriptExecution : DWScript_Execution;
+BEGIN
+  Result := FALSE;
+  IF (execution = NIL) THEN Exit;
+
+  scriptExecution := DWScript_Execution(execution);
+  TRY
+    scriptExecution.status := '';
+    scriptExecution.monitor.start(scriptExecution, scriptExecution.context, scriptExecution.dwsExecution);
+    //runs the main body to set up any globals, but leaves the program running so its functions can be invoked
+    IF scriptExecution.dwsExecution.BeginProgram THEN
+      scriptExecution.dwsExecution.RunProgram(scriptExecution.timeout);
+    scriptExecution.monitor.finish(scriptExecution, scriptExecution.dwsExecution);
+    IF scriptExecution.dwsExecution.Msgs.HasErrors THEN
+    BEGIN
+      scriptExecution.status := scriptExecution.dwsExecution.Msgs.AsInfo;
+      IF (scriptExecution.dwsExecution.ProgramState IN [psRunning, psRunningStopped]) THEN
+        scriptExecution.dwsExecution.EndProgram;
+      Exit;
+    END;
+    Result := TRUE;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptExecution.status := 'EXCEPTION (BeginExecution()): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+PROCEDURE DWScript_endExecution(execution : pointer); STDCALL;
+VAR
+  scriptExecution : DWScript_Execution;
+BEGIN
+  IF (execution = NIL) THEN Exit;
+
+  scriptExecution := DWScript_Execution(execution);
+  TRY
+    scriptExecution.status := '';
+    scriptExecution.releaseCallables;
+    IF (scriptExecution.dwsExecution.ProgramState IN [psRunning, psRunningStopped]) THEN
+      scriptExecution.dwsExecution.EndProgram;
+    flushOutput(scriptExecution.dwsExecution);
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptExecution.status := 'EXCEPTION (EndExecution()): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_findFunction(execution : pointer; functionName : PAnsiChar) : Pointer; STDCALL;
+VAR
+  scriptExecution : DWScript_Execution;
+  newCallable     : DWScript_Callable;
+  info            : IInfo;
+BEGIN
+  Result := NIL;
+  IF (execution = NIL) THEN Exit;
+
+  scriptExecution := DWScript_Execution(execution);
+  scriptExecution.status := '';
+  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptExecution.status := 'FindFunction() cannot accept a NULL or empty function name'; Exit; END;
+  IF (scriptExecution.dwsExecution.ProgramState <> psRunning) THEN BEGIN scriptExecution.status := 'FindFunction() requires an execution started with BeginExecution()'; Exit; END;
+
+  TRY
+    info := scriptExecution.dwsExecution.Info.Func[functionName];
+    newCallable       := DWScript_Callable.Create;
+    newCallable.owner := scriptExecution;
+    newCallable.info  := info;
+    scriptExecution.callables.Add(newCallable);
+    newCallable.prepare;
+    Result := newCallable;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptExecution.status := 'EXCEPTION (FindFunction("' + functionName + '"): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_invoke(callable : pointer; data : DWScript_DataPtr) : Boolean; STDCALL;
+VAR
+  scriptCallable : DWScript_Callable;
+  timeout        : Integer;
+BEGIN
+  Result := FALSE;
+  IF (callable = NIL) THEN Exit;
+  //data can be NULL, simply calls the function without parameters and without storing result
+
+  scriptCallable := DWScript_Callable(callable);
+  scriptCallable.owner.status := '';
+  //the engine only guards RunProgram(), so calls into a begun execution are guarded here, a stopped execution has to be ended
+  timeout := scriptCallable.owner.timeout;
+  IF (timeout > 0) THEN TdwsGuardianThread.GuardExecution(scriptCallable.owner.dwsExecution, timeout);
+  TRY
+    IF (scriptCallable.callExpr = NIL) THEN
+    BEGIN
+      Result := doCall(scriptCallable.owner, scriptCallable.info, data);
+      Exit;
+    END;
+
+    TRY
+      Result := scriptCallable.invoke(data);
+    EXCEPT
+      ON E: Exception DO
+      BEGIN
+        scriptCallable.owner.status := 'EXCEPTION (Calling function) : ' + E.ClassName + ': ' + E.Message;
+      END;
+    END;
+  FINALLY
+    IF (timeout > 0) THEN TdwsGuardianThread.ForgetExecution(scriptCallable.owner.dwsExecution);
+    flushOutput(scriptCallable.owner.dwsExecution);
+  END;
+END;
+
+FUNCTION DWScript_invokeBatch(callable : pointer; columns : DWScript_ColumnPtr; columnCount, rowCount : Integer; results : DWScript_ColumnPtr) : Boolean; STDCALL;
+VAR
+  scriptCallable  : DWScript_Callable;
+  scriptExecution : DWScript_Execution;
+  inputs          : ^DWScript_Columns;
+  cell            : DWScript_Variable;
+  wideString      : UnicodeString;
+  integerValue    : Int64;
+  floatValue      : Double;
+  booleanValue    : Boolean;
+  row, column     : Integer;
+  resultMatches   : Boolean;
+BEGIN
+  Result := FALSE;
+  IF (callable = NIL) THEN Exit;
+
+  scriptCallable  := DWScript_Callable(callable);
+  scriptExecution := scriptCallable.owner;
+  scriptExecution.status := '';
+  IF (columnCount < 0) OR (columnCount > 32) THEN BEGIN scriptExecution.status := 'InvokeBatch() can only accept between 0 and 32 columns'; Exit; END;
+  IF (columnCount > 0) AND (columns = NIL) THEN BEGIN scriptExecution.status := 'InvokeBatch() cannot accept NULL Columns'; Exit; END;
+  IF (rowCount < 0) THEN BEGIN scriptExecution.status := 'InvokeBatch() cannot accept a negative row count'; Exit; END;
+  //results can be NULL, simply calls the function for every row and discards the results
+  IF (scriptCallable.callExpr = NIL) THEN BEGIN scriptExecution.status := 'InvokeBatch() only accepts functions taking and returning integers, floats, booleans and strings by value'; Exit; END;
+  IF (columnCount <> Length(scriptCallable.arguments)) THEN BEGIN scriptExecution.status := 'InvokeBatch() was given ' + IntToStr(columnCount) + ' columns, the function expects ' + IntToStr(Length(scriptCallable.arguments)); Exit; END;
+
+  //every type is checked against the declared ones before the first call, so a batch never stops half way over a type
+  inputs := Pointer(columns);
+  FOR column := 0 TO columnCount - 1 DO
+    IF NOT scriptCallable.accepts(column, inputs^[column].dataType) THEN BEGIN scriptExecution.status := 'InvokeBatch() column ' + IntToStr(column) + ' does not match the type the script declares it as'; Exit; END;
+  IF (results <> NIL) THEN
+  BEGIN
+    CASE scriptCallable.resultType OF
+      DATATYPE_INTEGER: resultMatches := (results^.dataType = DATATYPE_INTEGER) OR (results^.dataType = DATATYPE_FLOAT);
+      DATATYPE_FLOAT:   resultMatches := (results^.dataType = DATATYPE_FLOAT);
+      DATATYPE_BOOLEAN: resultMatches := (results^.dataType = DATATYPE_BOOLEAN) OR (results^.dataType = DATATYPE_INTEGER);
+      DATATYPE_STRING:  resultMatches := (results^.dataType = DATATYPE_STRING) OR (results^.dataType = DATATYPE_UTF8);
+    ELSE
+      resultMatches := FALSE;
+    END;
+    IF NOT resultMatches THEN BEGIN scriptExecution.status := 'InvokeBatch() results column does not match the type the script declares the function returns'; Exit; END;
+    IF (results^.dataType = DATATYPE_STRING) OR (results^.dataType = DATATYPE_UTF8) THEN
+      SetLength(scriptExecution.batchStrings, rowCount);
+  END;
+
+  row := 0;
+  IF (scriptExecution.timeout > 0) THEN TdwsGuardianThread.GuardExecution(scriptExecution.dwsExecution, scriptExecution.timeout);
+  TRY
+    TRY
+      scriptCallable.enter;
+      FOR row := 0 TO rowCount - 1 DO
+      BEGIN
+        FOR column := 0 TO columnCount - 1 DO
+        BEGIN
+          cell.dataType := inputs^[column].dataType;
+          CASE cell.dataType OF
+            DATATYPE_INTEGER: cell.i := inputs^[column].i^[row];
+            DATATYPE_FLOAT:   cell.f := inputs^[column].f^[row];
+            DATATYPE_BOOLEAN: cell.b := (inputs^[column].b^[row] <> 0);
+            DATATYPE_STRING:  cell.s := inputs^[column].s^[row];
+            DATATYPE_UTF8:    cell.u := inputs^[column].u^[row];
+          END;
+          scriptCallable.setArgument(column, cell);
+        END;
+
+        WITH scriptCallable DO
+          CASE resultType OF
+            DATATYPE_INTEGER:
+            BEGIN
+              integerValue := callExpr.EvalAsInteger(execution);
+              IF (results = NIL) THEN Continue;
+              IF (results^.dataType = DATATYPE_FLOAT) THEN results^.f^[row] := integerValue
+              ELSE results^.i^[row] := integerValue;
+            END;
+            DATATYPE_FLOAT:
+            BEGIN
+              floatValue := callExpr.EvalAsFloat(execution);
+              IF (results <> NIL) THEN results^.f^[row] := floatValue;
+            END;
+            DATATYPE_BOOLEAN:
+            BEGIN
+              booleanValue := callExpr.EvalAsBoolean(execution);
+              IF (results = NIL) THEN Continue;
+              IF (results^.dataType = DATATYPE_INTEGER) THEN results^.i^[row] := Ord(booleanValue)
+              ELSE results^.b^[row] := Ord(booleanValue);
+            END;
+            DATATYPE_STRING:
+            BEGIN
+              callExpr.EvalAsString(execution, wideString);
+              IF (results = NIL) THEN Continue;
+              IF (results^.dataType = DATATYPE_UTF8) THEN
+              BEGIN
+                results^.u^[row].length := encodeUTF8(wideString, scriptExecution.batchStrings[row]);
+                results^.u^[row].text   := PAnsiChar(scriptExecution.batchStrings[row]);
+              END
+              ELSE
+              BEGIN
+                scriptExecution.batchStrings[row] := AnsiString(wideString); //DATATYPE_STRING is in the system code page, UTF-8 columns skip this
+                results^.s^[row] := PAnsiChar(scriptExecution.batchStrings[row]);
+              END;
+            END;
+          ELSE
+            callExpr.EvalNoResult(execution);
+          END;
+      END;
+      Result := TRUE;
+    EXCEPT
+      ON E: Exception DO
+      BEGIN
+        scriptExecution.status := 'EXCEPTION (InvokeBatch(), row ' + IntToStr(row) + '): ' + E.ClassName + ': ' + E.Message;
+      END;
+    END;
+  FINALLY
+    IF (scriptExecution.timeout > 0) THEN TdwsGuardianThread.ForgetExecution(scriptExecution.dwsExecution);
+    flushOutput(scriptExecution.dwsExecution);
+  END;
+END;
+
+PROCEDURE DWScript_setCacheCapacity(capacity : Integer); STDCALL;
+BEGIN
+  programCache.resize(capacity);
+END;
+
+FUNCTION DWScript_getCacheStatistics(statistics : DWScript_CacheStatisticsPtr) : Boolean; STDCALL;
+BEGIN
+  Result := FALSE;
+  IF (statistics = NIL) THEN Exit;
+  programCache.getStatistics(statistics^);
+  Result := TRUE;
+END;
+
+CONSTRUCTOR DWScript_Job.Create;
+BEGIN
+  INHERITED;
+  done := TEvent.Create(NIL, TRUE, FALSE, '');
+END;
+
+DESTRUCTOR DWScript_Job.Destroy;
+BEGIN
+  done.Free;
+  INHERITED;
+END;
+
+PROCEDURE DWScript_Job.run;
+BEGIN
+  success := runExecution(execution, timeoutMilliseconds);
+  status  := execution.Message;
+END;
+
+PROCEDURE DWScript_Worker.Execute;
+BEGIN
+  currentWorker := self;
+  WHILE NOT Terminated DO
+  BEGIN
+    job := pool.take;
+    IF (job = NIL) THEN
+    BEGIN
+      pool.wake.WaitFor(INFINITE);
+      Continue;
+    END;
+    IF NOT job.cancelled THEN
+      job.run
+    ELSE
+      job.status := 'Cancelled before it started';
+    pool.finish(job);
+    job := NIL;
+  END;
+  pool.wake.SetEvent; //pass the signal on, so every worker sees the pool stopping
+END;
+
+CONSTRUCTOR DWScript_WorkerPool.Create;
+BEGIN
+  INHERITED;
+  lock    := TFixedCriticalSection.Create;
+  wake    := TEvent.Create(NIL, FALSE, FALSE, '');
+  queue   := TList.Create;
+  workers := TList.Create;
+END;
+
+DESTRUCTOR DWScript_WorkerPool.Destroy;
+BEGIN
+  stop;
+  drain;
+  workers.Free;
+  queue.Free;
+  wake.Free;
+  lock.Free;
+  INHERITED;
+END;
+
+{ called with the lock held }
+PROCEDURE DWScript_WorkerPool.start;
+VAR
+  index  : Integer;
+  count  : Integer;
+  worker : DWScript_Worker;
+BEGIN
+  count := workerCount;
+{$ifdef FPC}
+  IF (count <= 0) THEN count := GetCPUCount;
+{$else}
+  IF (count <= 0) THEN count := CPUCount;
+{$endif}
+  IF (count <= 0) THEN count := 1;
+
+  stopping := FALSE;
+  FOR index := 1 TO count DO
+  BEGIN
+    worker      := DWScript_Worker.Create(TRUE);
+    worker.pool := self;
+    workers.Add(worker);
+    worker.Start;
+  END;
+  started := TRUE;
+END;
+
+{ waits for every worker to finish its current job and exit, anything still queued stays queued for the next start, or drain() }
+PROCEDURE DWScript_WorkerPool.stop;
+VAR
+  index : Integer;
+BEGIN
+  lock.Enter;
+  TRY
+    stopping := TRUE;
+    FOR index := 0 TO workers.Count - 1 DO
+      DWScript_Worker(workers[index]).Terminate;
+  FINALLY
+    lock.Leave;
+  END;
+  wake.SetEvent;
+  FOR index := 0 TO workers.Count - 1 DO
+  BEGIN
+    DWScript_Worker(workers[index]).WaitFor;
+    DWScript_Worker(workers[index]).Free;
+  END;
+  lock.Enter;
+  TRY
+    workers.Clear;
+    wake.ResetEvent;
+    started := FALSE;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+FUNCTION DWScript_WorkerPool.take : DWScript_Job;
+VAR
+  index : Integer;
+BEGIN
+  Result := NIL;
+  lock.Enter;
+  TRY
+    IF stopping OR (head = queue.Count) THEN Exit;
+    Result := DWScript_Job(queue[head]);
+    Inc(head);
+    //taking from the front would move everything behind it every time, so the taken ones are dropped in one go once they are half the list
+    IF (head * 2 >= queue.Count) THEN
+    BEGIN
+      FOR index := head TO queue.Count - 1 DO
+        queue[index - head] := queue[index];
+      queue.Count := queue.Count - head;
+      head := 0;
+    END;
+    Result.state := jsRunning;
+    Inc(busy);
+    IF (head < queue.Count) THEN wake.SetEvent;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_WorkerPool.finish(job : DWScript_Job);
+VAR
+  wasCancelled : Boolean;
+BEGIN
+  lock.Enter;
+  TRY
+    job.execution.pending := NIL;
+    job.execution.idle.SetEvent; //the job doesn't touch its execution after this
+    job.state    := jsFinished;
+    wasCancelled := job.cancelled;
+    Dec(busy);
+    IF wasCancelled THEN Inc(cancelled) ELSE Inc(completed);
+  FINALLY
+    lock.Leave;
+  END;
+  IF Assigned(job.callback) THEN
+    job.callback(job, Ord(job.success), job.userData);
+  //signalled last, the job may be destroyed as soon as anyone waiting on it wakes
+  job.done.SetEvent;
+END;
+
+{ called with the lock held, takes a queued job out of the queue when no worker is left to reach it,
+  if it returns TRUE the caller must finish() the job once the lock is released }
+FUNCTION DWScript_WorkerPool.withdraw(job : DWScript_Job) : Boolean;
+VAR
+  index : Integer;
+BEGIN
+  Result := (job.state = jsQueued) AND NOT started;
+  IF NOT Result THEN Exit;
+  index := queue.IndexOf(job);
+  IF (index >= head) THEN queue.Delete(index);
+  job.state     := jsRunning;
+  job.cancelled := TRUE;
+  job.status    := 'Cancelled, the worker pool was stopped';
+  Inc(busy);
+END;
+
+{ finishes everything left in the queue as cancelled, once the workers are gone, so nobody waits on a job that will never run }
+PROCEDURE DWScript_WorkerPool.drain;
+VAR
+  index     : Integer;
+  abandoned : TList;
+BEGIN
+  abandoned := TList.Create;
+  TRY
+    lock.Enter;
+    TRY
+      IF started THEN Exit;
+      FOR index := head TO queue.Count - 1 DO
+        abandoned.Add(queue[index]);
+      queue.Clear;
+      head := 0;
+      FOR index := 0 TO abandoned.Count - 1 DO
+        withdraw(DWScript_Job(abandoned[index]));
+    FINALLY
+      lock.Leave;
+    END;
+    //the callbacks are made without the lock, as they may submit or cancel other jobs
+    FOR index := 0 TO abandoned.Count - 1 DO
+      finish(DWScript_Job(abandoned[index]));
+  FINALLY
+    abandoned.Free;
+  END;
+END;
+
+FUNCTION DWScript_WorkerPool.submit(job : DWScript_Job) : Boolean;
+BEGIN
+  Result := FALSE;
+  lock.Enter;
+  TRY
+    IF halted THEN BEGIN job.execution.status := 'RunAsync() the worker pool has been stopped with SetWorkerCount(0)'; Exit; END;
+    IF (job.execution.pending <> NIL) THEN BEGIN job.execution.status := 'RunAsync() the execution is already queued or running'; Exit; END;
+    IF NOT started THEN start;
+    job.execution.pending := job;
+    job.execution.idle.ResetEvent;
+    job.state := jsQueued;
+    queue.Add(job);
+    Inc(submitted);
+    IF (queue.Count - head > peakQueued) THEN peakQueued := queue.Count - head;
+    Result := TRUE;
+  FINALLY
+    lock.Leave;
+  END;
+  wake.SetEvent;
+END;
+
+{ a queued job is skipped when a worker reaches it, or finished here if there are no workers, a running one is asked to stop by the engine }
+FUNCTION DWScript_WorkerPool.cancel(job : DWScript_Job) : Boolean;
+VAR
+  withdrawn : Boolean;
+BEGIN
+  withdrawn := FALSE;
+  lock.Enter;
+  TRY
+    Result := (job.state <> jsFinished);
+    IF NOT Result THEN Exit;
+    job.cancelled := TRUE;
+    IF (job.state = jsRunning) THEN
+      job.execution.dwsExecution.Stop
+    ELSE
+      withdrawn := withdraw(job);
+  FINALLY
+    lock.Leave;
+  END;
+  IF withdrawn THEN finish(job);
+END;
+
+FUNCTION DWScript_WorkerPool.release(execution : DWScript_Execution) : Boolean;
+VAR
+  job       : DWScript_Job;
+  withdrawn : Boolean;
+BEGIN
+  withdrawn := FALSE;
+  lock.Enter;
+  TRY
+    job    := execution.pending;
+    Result := (job = NIL) OR (currentWorker = NIL) OR (currentWorker.job <> job);
+    IF (job = NIL) OR NOT Result THEN Exit;
+    job.cancelled := TRUE;
+    IF (job.state = jsRunning) THEN
+      execution.dwsExecution.Stop
+    ELSE
+      withdrawn := withdraw(job);
+  FINALLY
+    lock.Leave;
+  END;
+  IF withdrawn THEN finish(job);
+  execution.idle.WaitFor(INFINITE);
+END;
+
+FUNCTION DWScript_WorkerPool.resize(newCount : Integer) : Boolean;
+BEGIN
+  Result := (currentWorker = NIL);
+  IF NOT Result THEN Exit;
+  IF (newCount < 0) THEN newCount := 0;
+  lock.Enter;
+  TRY
+    workerCount := newCount;
+    halted      := (newCount = 0);
+  FINALLY
+    lock.Leave;
+  END;
+  stop;
+  IF (newCount = 0) THEN
+  BEGIN
+    //no worker will ever reach what is still queued
+    drain;
+    Exit;
+  END;
+  lock.Enter;
+  TRY
+    IF NOT started AND (head < queue.Count) THEN start;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_WorkerPool.getStatistics(VAR statistics : DWScript_PoolStatistics);
+BEGIN
+  lock.Enter;
+  TRY
+    statistics.workers    := workers.Count;
+    statistics.busy       := busy;
+    statistics.queued     := queue.Count - head;
+    statistics.peakQueued := peakQueued;
+    statistics.submitted  := submitted;
+    statistics.completed  := completed;
+    statistics.cancelled  := cancelled;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+FUNCTION DWScript_runAsync(execution : pointer; timeoutMilliseconds : Integer; callback : DWScript_CompletionFunction; userdata : Pointer) : Pointer; STDCALL;
+VAR
+  scriptExecution : DWScript_Execution;
+  newJob          : DWScript_Job;
+BEGIN
+  Result := NIL;
+  IF (execution = NIL) THEN Exit;
+
+  scriptExecution := DWScript_Execution(execution);
+  scriptExecution.status := '';
+  IF (scriptExecution.dwsExecution.ProgramState <> psReadyToRun) THEN BEGIN scriptExecution.status := 'RunAsync() cannot run an execution that is running or has been begun with BeginExecution()'; Exit; END;
+
+  TRY
+    newJob                     := DWScript_Job.Create;
+    newJob.execution           := scriptExecution;
+    newJob.timeoutMilliseconds := timeoutMilliseconds;
+    newJob.callback            := callback;
+    newJob.userData            := userdata;
+    IF NOT workerPool.submit(newJob) THEN
+    BEGIN
+      newJob.Free; //submit() has said why on the execution
+      Exit;
+    END;
+    Result := newJob;
+  EXCEPT
+    ON E: Exception DO
+    BEGIN
+      scriptExecution.status := 'EXCEPTION (RunAsync()): ' + E.ClassName + ': ' + E.Message;
+    END;
+  END;
+END;
+
+FUNCTION DWScript_cancel(job : pointer) : Boolean; STDCALL;
+BEGIN
+  Result := FALSE;
+  IF (job = NIL) THEN Exit;
+  Result := workerPool.cancel(DWScript_Job(job));
+END;
+
+FUNCTION DWScript_wait(job : pointer; timeoutMilliseconds : Integer) : Boolean; STDCALL;
+BEGIN
+  Result := FALSE;
+  IF (job = NIL) THEN Exit;
+  IF (timeoutMilliseconds < 0) THEN
+    Result := (DWScript_Job(job).done.WaitFor(INFINITE) = wrSignaled)
+  ELSE
+    Result := (DWScript_Job(job).done.WaitFor(timeoutMilliseconds) = wrSignaled);
+END;
+
+PROCEDURE DWScript_destroyJob(job : pointer); STDCALL;
+BEGIN
+  IF (job = NIL) THEN Exit;
+  workerPool.cancel(DWScript_Job(job));
+  DWScript_Job(job).done.WaitFor(INFINITE);
+  DWScript_Job(job).Free;
+END;
+
+FUNCTION DWScript_setWorkerCount(count : Integer) : Boolean; STDCALL;
+BEGIN
+  Result := workerPool.resize(count);
+END;
+
+FUNCTION DWScript_getPoolStatistics(statistics : DWScript_PoolStatisticsPtr) : Boolean; STDCALL;
+BEGIN
+  Result := FALSE;
+  IF (statistics = NIL) THEN Exit;
+  workerPool.getStatistics(statistics^);
+  Result := TRUE;
+END;
+
+CONSTRUCTOR DWScript_Profile.Create;
+BEGIN
+  INHERITED;
+  lock     := TFixedCriticalSection.Create;
+  interval := 10;
+  lines    := TStringList.Create;
+  lines.CaseSensitive := TRUE;
+  lines.Sorted        := TRUE;
+  stacks   := TStringList.Create;
+  stacks.CaseSensitive := TRUE;
+  stacks.Sorted        := TRUE;
+END;
+
+DESTRUCTOR DWScript_Profile.Destroy;
+BEGIN
+  stacks.Free;
+  lines.Free;
+  lock.Free;
+  INHERITED;
+END;
+
+{ the counts are kept in the Objects of the sorted lists }
+PROCEDURE addSamples(list : TStringList; CONST key : String; count : Integer);
+VAR
+  index : Integer;
+BEGIN
+  IF list.Find(key, index) THEN
+    list.Objects[index] := TObject(NativeInt(list.Objects[index]) + count)
+  ELSE
+    list.AddObject(key, TObject(NativeInt(count)));
+END;
+
+PROCEDURE DWScript_Profile.add(CONST line, stack : String; count : Integer);
+BEGIN
+  lock.Enter;
+  TRY
+    addSamples(lines, line, count);
+    addSamples(stacks, stack, count);
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_Profile.reset;
+BEGIN
+  lock.Enter;
+  TRY
+    lines.Clear;
+    stacks.Clear;
+  FINALLY
+    lock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_SamplingClock.Execute;
+VAR
+  index   : Integer;
+  sampler : DWScript_Sampler;
+  current : Int64;
+  missed  : Integer;
+BEGIN
+  WHILE TRUE DO
+  BEGIN
+    samplersLock.Enter;
+    TRY
+      IF (samplers.Count = 0) THEN
+      BEGIN
+        clockRunning := FALSE; //nothing left to sample, the next sampler to start will start a new clock
+        Exit;
+      END;
+      current := GetSystemMilliseconds;
+      FOR index := 0 TO samplers.Count - 1 DO
+      BEGIN
+        sampler := DWScript_Sampler(samplers[index]);
+        IF (current >= sampler.due) THEN
+        BEGIN
+          //a late wake up still counts every interval that passed, so coarse sleeps only make samples lumpier
+          missed := (current - sampler.due) DIV sampler.interval + 1;
+          sampler.due   := sampler.due + missed * sampler.interval;
+          sampler.ticks := sampler.ticks + missed;
+        END;
+      END;
+    FINALLY
+      samplersLock.Leave;
+    END;
+    Sleep(1);
+  END;
+END;
+
+DESTRUCTOR DWScript_Sampler.Destroy;
+BEGIN
+  samplersLock.Enter;
+  TRY
+    samplers.Remove(self);
+  FINALLY
+    samplersLock.Leave;
+  END;
+  stack.Free;
+  INHERITED;
+END;
+
+PROCEDURE DWScript_Sampler.StartDebug(exec : TdwsExecution);
+VAR
+  clock : DWScript_SamplingClock;
+BEGIN
+  stack.Clear;
+  stack.Push(NIL);
+  lastExpr := NIL;
+  interval := profile.interval;
+  samplersLock.Enter;
+  TRY
+    due   := GetSystemMilliseconds + interval;
+    ticks := 0;
+    taken := 0;
+    samplers.Add(self);
+    IF NOT clockRunning THEN
+    BEGIN
+      clock := DWScript_SamplingClock.Create(TRUE);
+      clock.FreeOnTerminate := TRUE;
+      clock.Start;
+      clockRunning := TRUE;
+    END;
+  FINALLY
+    samplersLock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_Sampler.DoDebug(exec : TdwsExecution; expr : TExprBase);
+BEGIN
+  lastExpr := expr;
+  IF (ticks <> taken) THEN collect('');
+END;
+
+PROCEDURE DWScript_Sampler.StopDebug(exec : TdwsExecution);
+BEGIN
+  samplersLock.Enter;
+  TRY
+    samplers.Remove(self);
+  FINALLY
+    samplersLock.Leave;
+  END;
+END;
+
+PROCEDURE DWScript_Sampler.EnterFunc(exec : TdwsExecution; funcExpr : TExprBase);
+BEGIN
+  IF (funcExpr IS TFuncExprBase) THEN
+    stack.Push(TFuncExprBase(funcExpr).FuncSym);
 END;
 
-DESTRUCTOR DWScript_Context.Destroy;
+PROCEDURE DWScript_Sampler.LeaveFunc(exec : TdwsExecution; funcExpr : TExprBase);
+BEGIN
+  IF (funcExpr IS TFuncExprBase) THEN
+    stack.Pop;
+END;
+
+FUNCTION DWScript_Sampler.LastDebugStepExpr : TExprBase;
+BEGIN
+  Result := lastExpr;
+END;
+
+PROCEDURE DWScript_Sampler.DebugMessage(CONST msg : UnicodeString);
+BEGIN
+END;
+
+PROCEDURE DWScript_Sampler.NotifyException(exec : TdwsExecution; CONST exceptObj : IScriptObj);
+BEGIN
+END;
+
+PROCEDURE DWScript_Sampler.collect(CONST hostName : String);
 VAR
-  index       : Integer;
-  dwsFunction : DWScript_Function;
-  p           : Pointer;
+  count    : Integer;
+  index    : Integer;
+  position : TScriptPos;
+  source   : String;
+  funcName : String;
+  path     : String;
+  line     : Integer;
 BEGIN
-{$ifdef FPC}
-  FOR index := 0 TO functions.Count - 1 DO
+  count := ticks - taken;
+  IF (count <= 0) THEN Exit;
+  taken := taken + count;
+
+  path     := MSG_MainFunction;
+  funcName := MSG_MainFunction;
+  FOR index := 1 TO stack.Count - 1 DO
   BEGIN
-    dwsFunction := DWScript_Function(functions.Items[index]);
-    dwsFunction.Free;
+    funcName := TFuncSymbol(stack.List^[index]).QualifiedName;
+    path     := path + ';' + funcName;
   END;
-{$else}
-  FOR p IN functions.Values DO
+
+  source := MSG_MainModule;
+  line   := 0;
+  IF (hostName <> '') THEN
   BEGIN
-    dwsFunction := DWScript_Function(p);
-    dwsFunction.Free;
-  END;
-{$endif}
-  dwsScript.Free;
-  dwsUnit.Free;
-  dwsAsm.Free;
-  functions.Free;
-{$ifndef FPC}
-  IF (com <> NIL) THEN
+    funcName := hostName + ' [host]';
+    path     := path + ';' + funcName;
+    source   := '[host]';
+  END
+  ELSE IF (lastExpr <> NIL) THEN
   BEGIN
-    com.Free;
-    CoUninitialize;
+    position := lastExpr.ScriptPos;
+    IF position.Defined THEN
+    BEGIN
+      line := position.Line;
+      IF (position.SourceName <> '') THEN source := position.SourceName;
+    END;
   END;
-{$endif}
-  INHERITED;
+  profile.add(source + #9 + IntToStr(line) + #9 + funcName, path, count);
 END;
 
-PROCEDURE DWScript_Context.wrapper(Info : TProgramInfo);
+FUNCTION DWScript_Context.profileReport(format : Integer) : String;
 VAR
-  parameter       : Integer;
-  temporaryString : Ansistring;
-  dwsFunction     : DWScript_Function;
-  userFunction    : DWScript_CallbackFunction;
+  report      : TWriteOnlyBlockStream; //appended to rather than concatenated, which would copy the report so far for every line
+  totals      : TStringList;
+  hostCalls   : TStringList;
+  index       : Integer;
+  calls       : Integer;
+  position    : Integer;
+  key         : String;
+  dwsFunction : DWScript_Function;
+{$ifndef FPC}
+  p           : Pointer;
+{$endif}
 BEGIN
+  Result := '';
+  IF (profile = NIL) THEN Exit;
+
+  report    := TWriteOnlyBlockStream.AllocFromPool;
+  totals    := TStringList.Create;
+  hostCalls := TStringList.Create;
+  profile.lock.Enter;
   TRY
+    CASE format OF
+      PROFILE_LINES:
+        FOR index := 0 TO profile.lines.Count - 1 DO
+        BEGIN
+          report.WriteString(Int64(NativeInt(profile.lines.Objects[index])));
+          report.WriteChar(#9);
+          report.WriteString(UnicodeString(profile.lines[index]));
+          report.WriteChar(#10);
+        END;
+      PROFILE_COLLAPSED:
+        FOR index := 0 TO profile.stacks.Count - 1 DO
+        BEGIN
+          report.WriteString(UnicodeString(profile.stacks[index]));
+          report.WriteChar(' ');
+          report.WriteString(Int64(NativeInt(profile.stacks.Objects[index])));
+          report.WriteChar(#10);
+        END;
+      PROFILE_FUNCTIONS:
+      BEGIN
+        totals.CaseSensitive    := TRUE;
+        totals.Sorted           := TRUE;
+        hostCalls.CaseSensitive := TRUE;
+        hostCalls.Sorted        := TRUE;
+        //self samples per function are the samples of its lines, the function name being the last field
+        FOR index := 0 TO profile.lines.Count - 1 DO
+        BEGIN
+          key := profile.lines[index];
+          position := LastDelimiter(#9, key);
+          addSamples(totals, Copy(key, position + 1, MaxInt), NativeInt(profile.lines.Objects[index]));
+        END;
+        //host callbacks also report how often they were called, even if they were never caught in a sample
 {$ifdef FPC}
-    dwsFunction := DWScript_Function(functions.Find(info.FuncSym.ExternalName));
+        FOR index := 0 TO functions.Count - 1 DO
+        BEGIN
+          dwsFunction := DWScript_Function(functions.Items[index]);
 {$else}
-    functions.TryGetValue(info.FuncSym.ExternalName, Pointer(dwsFunction));
+        FOR p IN functions.Values DO
+        BEGIN
+          dwsFunction := DWScript_Function(p);
 {$endif}
-    IF (dwsFunction = NIL) OR (dwsFunction.userFunction = NIL) THEN Exit;
-
-    FOR parameter := 0 TO dwsFunction.dwsData.valueCount - 1 DO
-      CASE dwsFunction.dwsData.value[parameter].dataType OF
-        DATATYPE_INTEGER: dwsFunction.dwsData.value[parameter].i := Info.ValueAsInteger[dwsFunction.parameterNames[parameter]];
-        DATATYPE_FLOAT:   dwsFunction.dwsData.value[parameter].f := Info.ValueAsFloat[dwsFunction.parameterNames[parameter]];
-        DATATYPE_BOOLEAN: dwsFunction.dwsData.value[parameter].b := Info.ValueAsBoolean[dwsFunction.parameterNames[parameter]];
-        DATATYPE_STRING:
+          IF (dwsFunction.calls = 0) THEN Continue;
+          addSamples(totals, dwsFunction.name + ' [host]', 0);
+          addSamples(hostCalls, dwsFunction.name + ' [host]', dwsFunction.calls);
+        END;
+        FOR index := 0 TO totals.Count - 1 DO
         BEGIN
-          temporaryString := Info.ValueAsString[dwsFunction.parameterNames[parameter]];
-          dwsFunction.dwsData.value[parameter].s := PAnsiChar(temporaryString);
+          calls := 0;
+          IF hostCalls.Find(totals[index], position) THEN calls := NativeInt(hostCalls.Objects[position]);
+          report.WriteString(Int64(NativeInt(totals.Objects[index])));
+          report.WriteChar(#9);
+          report.WriteString(calls);
+          report.WriteChar(#9);
+          report.WriteString(UnicodeString(totals[index]));
+          report.WriteChar(#10);
         END;
       END;
-
-    dwsFunction.dwsData.context := self;
-    dwsFunction.dwsData.state   := info;
-    userFunction                := DWScript_CallbackFunction(dwsFunction.userFunction);
-    userFunction(@dwsFunction.dwsData, dwsFunction.userData);
-    dwsFunction.dwsData.state   := NIL;
-
-    CASE dwsFunction.dwsData.returnValue.dataType OF
-      DATATYPE_INTEGER: Info.ResultAsInteger := dwsFunction.dwsData.returnValue.i;
-      DATATYPE_FLOAT:   Info.ResultAsFloat := dwsFunction.dwsData.returnValue.f;
-      DATATYPE_BOOLEAN: Info.ResultAsBoolean := dwsFunction.dwsData.returnValue.b;
-      DATATYPE_STRING:  Info.ResultAsString := dwsFunction.dwsData.returnValue.s;
-    END;
-  EXCEPT
-    ON E: Exception DO
-    BEGIN
-      status := 'EXCEPTION (Finding function): ' + E.ClassName + ': ' + E.Message;
-      //need to figure out how to propogate this error
-      Exit;
     END;
+    Result := report.ToString;
+  FINALLY
+    profile.lock.Leave;
+    hostCalls.Free;
+    totals.Free;
+    report.ReturnToPool;
   END;
 END;
 
-
-
-
-FUNCTION DWScript_addParameter(context : pointer; dwsFunctionPtr : Pointer; parameterName : PAnsiChar; dataType : Integer) : Boolean; STDCALL;
+FUNCTION DWScript_setProfiling(context : pointer; intervalMilliseconds : Integer) : Boolean; STDCALL;
 VAR
-  parameter : TdwsParameter;
   scriptContext : DWScript_Context;
 BEGIN
   Result := FALSE;
   IF (context = NIL) THEN Exit;
 
   scriptContext := DWScript_Context(context);
-
   scriptContext.status := '';
-  IF (dwsFunctionPtr = NIL) THEN BEGIN scriptContext.status := 'AddParameter() cannot accept a NULL Function parameter'; Exit; END;
-  IF (parameterName = NIL) OR (Length(parameterName) = 0) THEN BEGIN   scriptContext.status := 'AddParameter() cannot accept a NULL or empty parameter name'; Exit; END;
+  IF (intervalMilliseconds < 0) THEN BEGIN scriptContext.status := 'SetProfiling() cannot accept a negative interval'; Exit; END;
 
-  WITH DWScript_Function(dwsFunctionPtr) DO
+  IF (scriptContext.profile = NIL) THEN
   BEGIN
-    parameter := dwsFunction.Parameters.Add;
-    parameter.Name := parameterName;
-
-    parameterNames[dwsData.valueCount] := parameterName;
-    dwsData.value[dwsData.valueCount].dataType := dataType;
-    dwsData.value[dwsData.valueCount].name := PAnsiChar(parameterNames[dwsData.valueCount]);
-    CASE dataType OF
-      DATATYPE_INTEGER: parameter.DataType := 'Integer';
-      DATATYPE_FLOAT:   parameter.DataType := 'Float';
-      DATATYPE_BOOLEAN: parameter.DataType := 'Boolean';
-      DATATYPE_STRING:  parameter.DataType := 'String';
-    ELSE
-      BEGIN scriptContext.status := 'AddParameter() Invalid data type specified'; Exit; END;
-    END;
-
-    dwsData.valueCount := dwsData.valueCount + 1;
+    IF (intervalMilliseconds = 0) THEN BEGIN Result := TRUE; Exit; END;
+    scriptContext.profile := DWScript_Profile.Create;
   END;
-
+  IF (intervalMilliseconds > 0) THEN scriptContext.profile.interval := intervalMilliseconds;
+  scriptContext.profile.enabled := (intervalMilliseconds > 0);
   Result := TRUE;
 END;
 
-FUNCTION DWScript_setReturnType(context : pointer; dwsFunctionPtr : Pointer; dataType : Integer) : Boolean; STDCALL;
+PROCEDURE DWScript_resetProfile(context : pointer); STDCALL;
 VAR
   scriptContext : DWScript_Context;
+  index         : Integer;
+{$ifndef FPC}
+  p             : Pointer;
+{$endif}
 BEGIN
-  Result := FALSE;
   IF (context = NIL) THEN Exit;
 
   scriptContext := DWScript_Context(context);
-
-  scriptContext.status := '';
-  IF (dwsFunctionPtr = NIL) THEN BEGIN scriptContext.status := 'SetReturnType() cannot accept a NULL Function parameter'; Exit; END;
-
-  WITH DWScript_Function(dwsFunctionPtr) DO
-  BEGIN
-    dwsData.returnValue.dataType := dataType;
-    CASE dataType OF
-      DATATYPE_INTEGER: dwsFunction.ResultType := 'Integer';
-      DATATYPE_FLOAT:   dwsFunction.ResultType := 'Float';
-      DATATYPE_BOOLEAN: dwsFunction.ResultType := 'Boolean';
-      DATATYPE_STRING:  dwsFunction.ResultType := 'String';
-    ELSE
-      BEGIN scriptContext.status := 'SetReturnType() Invalid data type specified'; Exit; END;
-    END;
-  END;
-  Result := TRUE;
+  IF (scriptContext.profile = NIL) THEN Exit;
+  scriptContext.profile.reset;
+{$ifdef FPC}
+  FOR index := 0 TO scriptContext.functions.Count - 1 DO
+    DWScript_Function(scriptContext.functions.Items[index]).calls := 0;
+{$else}
+  FOR p IN scriptContext.functions.Values DO
+    DWScript_Function(p).calls := 0;
+{$endif}
 END;
 
-FUNCTION DWScript_addFunction(context : pointer; functionName : PAnsiChar; userFunction, userData : Pointer) : Pointer; STDCALL;
+FUNCTION DWScript_getProfile(context : pointer; format : Integer; buffer : PAnsiChar; size : Integer) : Integer; STDCALL;
 VAR
-  newFunction : DWScript_Function;
   scriptContext : DWScript_Context;
+  report        : AnsiString;
 BEGIN
-  Result := NIL;
+  Result := 0;
   IF (context = NIL) THEN Exit;
 
   scriptContext := DWScript_Context(context);
-
   scriptContext.status := '';
-  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'AddFunction() cannot accept a NULL or empty function name'; Exit; END;
-  IF (userFunction = NIL) THEN BEGIN scriptContext.status := 'AddFunction() cannot accept a NULL Callback parameter'; Exit; END;
-{$ifdef FPC} //using the FPHashList for now, which uses ShortStrings as keys, hence this restriction
-  IF (Length(functionName) > 255) THEN BEGIN scriptContext.status := 'AddFunction() Function name must be less than 256 characters in length'; Exit; END;
-{$endif};
+  IF (format < PROFILE_LINES) OR (format > PROFILE_COLLAPSED) THEN BEGIN scriptContext.status := 'GetProfile() Invalid format specified'; Exit; END;
 
-  newFunction := DWScript_Function.Create;
-  WITH newFunction DO
-  BEGIN
-    dwsFunction            := scriptContext.dwsUnit.Functions.Add;
-    dwsFunction.Name       := functionName;
-    name                   := functionName;
-    dwsData.valueCount     := 0;
-    dwsData.functionName   := PAnsiChar(name);
-    dwsData.state          := NIL;
-{$ifdef FPC}
-    dwsFunction.OnEval     := @scriptContext.wrapper;
-{$else}
-    dwsFunction.OnEval     := scriptContext.wrapper;
-{$endif}
-  END;
-  newFunction.userFunction := userFunction; //do this here because of naming clashes, TODO: make more sane variable names
-  newFunction.userData     := userData;
-  scriptContext.functions.Add(functionName, newFunction);
-  Result := newFunction;
+  report := AnsiString(scriptContext.profileReport(format));
+  Result := Length(report);
+  IF (buffer = NIL) OR (size <= 0) THEN Exit;
+
+  IF (Result >= size) THEN Result := size - 1;
+  IF (Result > 0) THEN Move(PAnsiChar(report)^, buffer^, Result);
+  buffer[Result] := #0;
 END;
 
-FUNCTION doCall(scriptContext : DWScript_Context; Info : IInfo; data : DWScript_DataPtr) : Boolean;
+FUNCTION DWScript_setLimits(handle : pointer; limits : DWScript_LimitsPtr) : Boolean; STDCALL;
 VAR
-  parameters  : ARRAY OF Variant;
-  index       : Integer;
-  returnValue : IInfo;
-  stringValue : AnsiString;
+  scriptContext   : DWScript_Context;
+  scriptExecution : DWScript_Execution;
+  mainProgram     : TdwsMainProgram;
+  stack           : TStack;
 BEGIN
-  Result := TRUE;
-  TRY
-    //set up any required parameters
-    IF (data <> NIL) THEN
-    BEGIN
-      SetLength(parameters, data^.valueCount);
-      FOR index := 0 TO data^.valueCount-1 DO
-      BEGIN
-        CASE data^.value[index].dataType OF
-          DATATYPE_INTEGER: parameters[index] := data^.value[index].i;
-          DATATYPE_FLOAT:   parameters[index] := data^.value[index].f;
-          DATATYPE_BOOLEAN: parameters[index] := data^.value[index].b;
-          DATATYPE_STRING:  BEGIN stringValue := data^.value[index].s; parameters[index] := stringValue; END;
-        END;
-      END;
-    END;
-    //call the function
-    returnValue := Info.Call(parameters);
-    //store its return value if required
-    IF (data <> NIL) THEN
+  Result := FALSE;
+  IF (handle = NIL) THEN Exit;
+
+  DWScript_Object(handle).status := '';
+  IF (limits = NIL) THEN BEGIN DWScript_Object(handle).status := 'SetLimits() cannot accept NULL Limits'; Exit; END;
+  WITH limits^ DO
+    IF (timeoutMilliseconds < 0) OR (maxRecursionDepth < 0) OR (maxDataSize < 0) OR (stackChunkSize < 0) THEN
     BEGIN
-      data^.returnValue.dataType := DATATYPE_NOTSET;
-      CASE VarType(returnValue.Value) OF
-        varInteger, varInt64, varSmallInt, varWord, varByte, varLongWord:
-          BEGIN data^.returnValue.dataType := DATATYPE_INTEGER; data^.returnValue.i := returnValue.GetValueAsInteger; END;
-        varSingle, varDouble:
-          BEGIN data^.returnValue.dataType := DATATYPE_FLOAT;   data^.returnValue.f := returnValue.GetValueAsFloat; END;
-        varBoolean:
-          BEGIN data^.returnValue.dataType := DATATYPE_BOOLEAN; data^.returnValue.b := returnValue.GetValueAsBoolean; END;
-        varString:
-          BEGIN data^.returnValue.dataType := DATATYPE_STRING;  data^.returnValue.s := PAnsiChar(returnValue.GetValueAsString); END; //FLAMES! Need memory management
-        ELSE
-          BEGIN scriptContext.status := 'Unhandled script return type'; Result := FALSE; END;
-      END;
+      DWScript_Object(handle).status := 'SetLimits() cannot accept negative limits';
+      Exit;
     END;
-  EXCEPT
-    ON E: Exception DO
+
+  IF (TObject(handle) IS DWScript_Context) THEN
+  BEGIN
+    //these only reach programs compiled from now on, 0 puts back the engine's default
+    scriptContext := DWScript_Context(handle);
+    WITH scriptContext.dwsScript.Config DO
     BEGIN
-      scriptContext.status := 'EXCEPTION (Calling function) : ' + E.ClassName + ': ' + E.Message;
-      Result := FALSE;
+      TimeoutMilliseconds := limits^.timeoutMilliseconds;
+      MaxDataSize         := limits^.maxDataSize;
+      IF (limits^.maxRecursionDepth > 0) THEN MaxRecursionDepth := limits^.maxRecursionDepth ELSE MaxRecursionDepth := cDefaultMaxRecursionDepth;
+      IF (limits^.stackChunkSize > 0) THEN StackChunkSize := limits^.stackChunkSize ELSE StackChunkSize := cDefaultStackChunkSize;
     END;
+    Result := TRUE;
+  END
+  ELSE IF (TObject(handle) IS DWScript_Execution) THEN
+  BEGIN
+    //the execution's stack was already allocated from its program's parameters, only its limits can change, 0 puts back the program's
+    scriptExecution := DWScript_Execution(handle);
+    IF (limits^.stackChunkSize <> 0) THEN BEGIN scriptExecution.status := 'SetLimits() stackChunkSize can only be set on a context'; Exit; END;
+    mainProgram := scriptExecution.owner.dwsProgram.ProgramObject;
+    stack       := scriptExecution.dwsExecution.Stack;
+    IF (limits^.timeoutMilliseconds > 0) THEN scriptExecution.timeout := limits^.timeoutMilliseconds ELSE scriptExecution.timeout := mainProgram.TimeoutMilliseconds;
+    IF (limits^.maxRecursionDepth > 0) THEN stack^.MaxRecursionDepth := limits^.maxRecursionDepth ELSE stack^.MaxRecursionDepth := mainProgram.MaxRecursionDepth;
+    IF (limits^.maxDataSize > 0) THEN stack^.MaxSize := limits^.maxDataSize DIV SizeOf(Variant) ELSE stack^.MaxSize := mainProgram.MaxDataSize DIV SizeOf(Variant);
+    Result := TRUE;
+  END
+  ELSE
+    DWScript_Object(handle).status := 'SetLimits() can only accept a context or an execution';
+END;
+
+FUNCTION DWScript_getStatistics(handle : pointer; statistics : DWScript_StatisticsPtr; reset : Integer) : Boolean; STDCALL;
+VAR
+  monitor : DWScript_Monitor;
+BEGIN
+  Result := FALSE;
+  IF (handle = NIL) OR (statistics = NIL) THEN Exit;
+
+  IF (TObject(handle) IS DWScript_Context) THEN
+    monitor := DWScript_Context(handle).monitor
+  ELSE IF (TObject(handle) IS DWScript_Execution) THEN
+    monitor := DWScript_Execution(handle).monitor
+  ELSE
+    Exit;
+
+  //a context's totals are merged into by every run finishing, so every counter is read under the same lock for a consistent snapshot
+  DWScript_Object(handle).statusLock.Enter;
+  TRY
+    //picks up anything created by invokes since its last run
+    IF (TObject(handle) IS DWScript_Execution) THEN
+      monitor.count(DWScript_Execution(handle).dwsExecution.ExecutionObject AS TdwsProgramExecution);
+    statistics^ := monitor.statistics;
+    IF (reset <> 0) THEN FillChar(monitor.statistics, SizeOf(monitor.statistics), 0);
+  FINALLY
+    DWScript_Object(handle).statusLock.Leave;
   END;
+  Result := TRUE;
 END;
 
-FUNCTION DWScript_call(context : pointer; state : Pointer; functionName : PAnsiChar; data : DWScript_DataPtr) : Boolean; STDCALL;
+FUNCTION DWScript_parseJSON(context : pointer; text : PAnsiChar; length : Integer) : Pointer; STDCALL;
 VAR
-  info : TProgramInfo;
   scriptContext : DWScript_Context;
+  scriptJSON    : DWScript_JSON;
 BEGIN
-  Result := FALSE;
+  Result := NIL;
   IF (context = NIL) THEN Exit;
 
   scriptContext := DWScript_Context(context);
   scriptContext.status := '';
-  IF (state = NIL) THEN BEGIN scriptContext.status := 'Call() cannot accept a NULL State parameter'; Exit; END;
-  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'Call() cannot accept a NULL or empty function name'; Exit; END;
-  //data can be NULL, simply calls the function without parameters and without storing result
+  IF (text = NIL) THEN BEGIN scriptContext.status := 'ParseJSON() cannot accept a NULL Text parameter'; Exit; END;
+  IF (length < 0) THEN length := StrLen(text);
 
+  scriptJSON := NIL;
   TRY
-    info := TProgramInfo(state);
-    Result := doCall(scriptContext, info.Execution.ProgramInfo.Func[functionName], data);
+    //the UTF-8 is read where it is, without being converted to a string first
+    scriptJSON := DWScript_JSON.Create;
+    scriptJSON.boxed := BoxedJSONValue(TdwsJSONValue.ParseUTF8(text, length));
+    Result := scriptJSON;
   EXCEPT
     ON E: Exception DO
     BEGIN
-      scriptContext.status := 'EXCEPTION (Call("' + functionName + '"): ' + E.ClassName + ': ' + E.Message;
+      Result := NIL;
+      scriptJSON.Free;
+      scriptContext.status := 'EXCEPTION (ParseJSON()): ' + E.ClassName + ': ' + E.Message;
     END;
   END;
 END;
 
-FUNCTION DWScript_callStateless(context : pointer; functionName : PAnsiChar; data : DWScript_DataPtr) : Boolean; STDCALL;
+FUNCTION DWScript_getJSON(json : pointer; buffer : PAnsiChar; size : Integer) : Integer; STDCALL;
 VAR
-  execution : IdwsProgramExecution;
-  scriptContext : DWScript_Context;
+  scriptJSON : DWScript_JSON;
+  text       : RawByteString;
 BEGIN
-  Result := FALSE;
-  IF (context = NIL) THEN Exit;
-
-  scriptContext := DWScript_Context(context);
-  scriptContext.status := '';
-  IF (functionName = NIL) OR (Length(functionName) = 0) THEN BEGIN scriptContext.status := 'CallStateless() cannot accept a NULL or empty function name'; Exit; END;
-  //data can be NULL, simply calls the function without parameters and without storing result
+  Result := 0;
+  IF (json = NIL) THEN Exit;
 
+  scriptJSON := DWScript_JSON(json);
+  scriptJSON.status := '';
   TRY
-    execution := scriptContext.dwsProgram.CreateNewExecution;
-    Result := doCall(scriptContext, execution.Info.Func[functionName], data);
+    //serialised on every call, as a script sharing the document may change it between a length query and the call filling the buffer
+    text   := scriptJSON.boxed.Value.ToUTF8String;
+    Result := System.Length(text);
+    IF (buffer = NIL) OR (size <= 0) THEN Exit;
+
+    IF (Result >= size) THEN Result := size - 1;
+    IF (Result > 0) THEN Move(PAnsiChar(text)^, buffer^, Result);
+    buffer[Result] := #0;
   EXCEPT
     ON E: Exception DO
     BEGIN
-      scriptContext.status := 'EXCEPTION (CallStateless("' + functionName + '"): ' + E.ClassName + ': ' + E.Message;
+      scriptJSON.status := 'EXCEPTION (GetJSON()): ' + E.ClassName + ': ' + E.Message;
+      Result := 0;
     END;
   END;
 END;
 
-FUNCTION DWScript_compile(context : pointer; scriptText : PAnsiChar; flags : Integer) : Boolean; STDCALL;
+PROCEDURE DWScript_destroyJSON(json : pointer); STDCALL;
+BEGIN
+  IF (json = NIL) THEN Exit;
+  DWScript_JSON(json).Free;
+END;
+
+FUNCTION DWScript_setOutput(handle : pointer; callback : DWScript_OutputFunction; userdata : Pointer; bufferSize : Integer) : Boolean; STDCALL;
 VAR
-{$ifdef JITTER}
-  jitter : TdwsJITx86;
-{$endif}
-  scriptContext : DWScript_Context;
+  monitor : DWScript_Monitor;
 BEGIN
   Result := FALSE;
-  IF (context = NIL) THEN Exit;
+  IF (handle = NIL) THEN Exit;
 
-  scriptContext := DWScript_Context(context);
-  scriptContext.status := '';
-  IF (scriptText = NIL) OR (Length(scriptText) = 0) THEN BEGIN scriptContext.status := 'Compile() cannot accept a NULL or empty Script parameter'; Exit; END;
+  DWScript_Object(handle).status := '';
+  IF (TObject(handle) IS DWScript_Context) THEN
+    monitor := DWScript_Context(handle).monitor
+  ELSE IF (TObject(handle) IS DWScript_Execution) THEN
+    monitor := DWScript_Execution(handle).monitor
+  ELSE
+  BEGIN
+    DWScript_Object(handle).status := 'SetOutput() can only accept a context or an execution';
+    Exit;
+  END;
+  IF (bufferSize < 0) THEN BEGIN DWScript_Object(handle).status := 'SetOutput() cannot accept a negative buffer size'; Exit; END;
 
+  //taken up by the next run to begin, one that has already begun keeps the sink it began with
+  IF (bufferSize = 0) THEN bufferSize := 65536;
+  IF (bufferSize < 16) THEN bufferSize := 16;
+  DWScript_Object(handle).statusLock.Enter;
   TRY
-    scriptContext.dwsProgram := scriptContext.dwsScript.Compile(scriptText);
-    IF scriptContext.dwsProgram.Msgs.Count > 0 THEN
-    BEGIN
-      scriptContext.status := scriptContext.dwsProgram.Msgs.AsInfo
-    END ELSE
-    BEGIN
-      {$ifdef JITTER}
-      IF (flags AND FLAG_JITTER <> 0) THEN
-      BEGIN
-        jitter := TdwsJITx86.Create;
-        jitter.Options := jitter.Options-[jitoNoBranchAlignment];
-        jitter.GreedyJIT(scriptContext.dwsProgram.ProgramObject);
-        jitter.Free;
-      END;
-      {$else}
-      IF (flags AND FLAG_JITTER <> 0) THEN scriptContext.status := 'WARNING: Jitter not supported in this build';
-      {$endif}
-      Result := True;
-    END;
-  EXCEPT
-    ON E: Exception DO
-    BEGIN
-      scriptContext.status := scriptContext.status + 'EXCEPTION (Compile()): ' + E.ClassName + ': ' + E.Message;
-    END;
+    monitor.output.callback := callback;
+    monitor.output.userData := userdata;
+    monitor.output.size     := bufferSize;
+  FINALLY
+    DWScript_Object(handle).statusLock.Leave;
   END;
+  Result := TRUE;
+END;
 
+PROCEDURE freeTextCaches;
+VAR
+  index : Integer;
+BEGIN
+  FOR index := 0 TO textCaches.Count - 1 DO
+    DWScript_TextCache(textCaches[index]).Free;
+  textCaches.Free;
 END;
 
-FUNCTION DWScript_execute(context : pointer; flags : Integer) : Boolean; STDCALL;
+FUNCTION DWScript_shareArray(context : pointer; name : PAnsiChar; elementType : Integer; data : Pointer; count, stride, readOnly : Integer) : Boolean; STDCALL;
+CONST
+  ELEMENT_SIZES : ARRAY[ELEMENT_INT32..ELEMENT_BOOLEAN] OF Integer = (4, 8, 4, 8, 1);
 VAR
   scriptContext : DWScript_Context;
+  arrays        : DWScript_SharedArrays;
+  arrayName     : UnicodeString;
+  index         : Integer;
 BEGIN
   Result := FALSE;
   IF (context = NIL) THEN Exit;
 
   scriptContext := DWScript_Context(context);
+  scriptContext.status := '';
+  IF (name = NIL) OR (Length(name) = 0) THEN BEGIN scriptContext.status := 'ShareArray() cannot accept a NULL or empty name'; Exit; END;
+  IF (elementType < ELEMENT_INT32) OR (elementType > ELEMENT_BOOLEAN) THEN BEGIN scriptContext.status := 'ShareArray() Invalid element type specified'; Exit; END;
+  IF (count < 0) OR (stride < 0) THEN BEGIN scriptContext.status := 'ShareArray() cannot accept a negative count or stride'; Exit; END;
+  IF (data = NIL) AND (count > 0) THEN BEGIN scriptContext.status := 'ShareArray() cannot accept NULL Data with a count'; Exit; END;
+
+  arrayName := UnicodeString(AnsiString(name));
+  //a copy is changed and then swapped in, so runs already going keep the arrays they started with
+  scriptContext.statusLock.Enter;
   TRY
-    scriptContext.status := '';
-    scriptContext.dwsProgram.Execute;
-    scriptContext.status := 'Finished executing';
-    Result := TRUE;
-  EXCEPT
-    ON E: Exception DO
+    arrays := Copy(scriptContext.arrays);
+    index  := 0;
+    WHILE (index < Length(arrays)) AND NOT UnicodeSameText(arrays[index].name, arrayName) DO
+      Inc(index);
+    IF (data = NIL) THEN
+    BEGIN
+      //unshared, the last array moves into the freed slot, so scripts must look it up again by name
+      IF (index < Length(arrays)) THEN
+      BEGIN
+        arrays[index] := arrays[High(arrays)];
+        SetLength(arrays, Length(arrays) - 1);
+      END;
+    END
+    ELSE
     BEGIN
-      scriptContext.status := 'EXCEPTION (Run): ' + E.ClassName + ': ' + E.Message;
+      IF (index = Length(arrays)) THEN SetLength(arrays, index + 1);
+      arrays[index].name        := arrayName;
+      arrays[index].data        := data;
+      arrays[index].count       := count;
+      arrays[index].elementType := elementType;
+      arrays[index].readOnly    := (readOnly <> 0);
+      IF (stride > 0) THEN arrays[index].stride := stride ELSE arrays[index].stride := ELEMENT_SIZES[elementType];
     END;
+    scriptContext.arrays := arrays;
+  FINALLY
+    scriptContext.statusLock.Leave;
   END;
+  Result := TRUE;
 END;
 
+INITIALIZATION
+  programCache := DWScript_ProgramCache.Create;
+  workerPool   := DWScript_WorkerPool.Create;
+  samplers     := TList.Create;
+  samplersLock := TFixedCriticalSection.Create;
+  outputType   := DWScript_OutputType.Create(NIL);
+  textCaches   := TList.Create;
+  textLock     := TFixedCriticalSection.Create;
+
+FINALIZATION
+  workerPool.Free;
+  programCache.Free;
+  samplersLock.Free;
+  samplers.Free;
+  outputType.Free;
+  freeTextCaches;
+  textLock.Free;
+
 END.
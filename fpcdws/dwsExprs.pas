@@ -517,6 +517,7 @@ type
 
          FFirstObject, FLastObject : TScriptObj;
          FObjectCount : Integer;
+         FObjectsCreated : Integer;
 
          FProgramInfo : TProgramInfo;
          FProgInfoPool : TProgramInfo;
@@ -611,6 +612,7 @@ type
          property RTTIRawAttributes : IScriptObj read FRTTIRawAttributes write FRTTIRawAttributes;
 
          property ObjectCount : Integer read FObjectCount;
+         property ObjectsCreated : Integer read FObjectsCreated;
 
          property OnExecutionStarted : TdwsExecutionEvent read FOnExecutionStarted write FOnExecutionStarted;
          property OnExecutionEnded : TdwsExecutionEvent read FOnExecutionEnded write FOnExecutionEnded;
@@ -2392,6 +2394,7 @@ begin
       FLastObject:=scriptObj;
    end;
    Inc(FObjectCount);
+   Inc(FObjectsCreated);
 end;
 
 // ScriptObjDestroyed
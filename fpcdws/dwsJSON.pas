@@ -107,12 +107,18 @@ type
       private
          Str : UnicodeString;
          Ptr, ColStart : PWideChar;
+         UTF8Ptr, UTF8ColStart, UTF8Start, UTF8End : PAnsiChar; // nil unless parsing UTF-8
          Line : Integer;
          FTrailCharacter : WideChar;
          DuplicatesOption : TdwsJSONDuplicatesOptions;
 
+         function NeedUTF8Char : WideChar;
+         procedure ParseUTF8JSONString(var result : UnicodeString);
+
       public
          constructor Create(const aStr : UnicodeString);
+         // reads the buffer in place, it must stay valid while parsing
+         constructor CreateUTF8(aText : PAnsiChar; aLength : Integer);
 
          function Location : UnicodeString;
 
@@ -187,6 +193,8 @@ type
          class function ParseString(const json : UnicodeString;
                                     duplicatesOption : TdwsJSONDuplicatesOptions = jdoOverwrite) : TdwsJSONValue; static;
          class function ParseFile(const fileName : UnicodeString) : TdwsJSONValue; static;
+         class function ParseUTF8(text : PAnsiChar; length : Integer;
+                                  duplicatesOption : TdwsJSONDuplicatesOptions = jdoOverwrite) : TdwsJSONValue; static;
 
          function Clone : TdwsJSONValue;
          procedure Extend(other : TdwsJSONValue);
@@ -195,6 +203,7 @@ type
          procedure WriteToStream(aStream : TStream); overload;
          procedure WriteToStream(aStream : TWriteOnlyBlockStream); overload;
          function ToString : UnicodeString; reintroduce;
+         function ToUTF8String : RawByteString;
          function ToBeautifiedString(initialTabs : Integer = 0; indentTabs : Integer = 1) : UnicodeString;
          procedure Detach;
 
@@ -420,12 +429,24 @@ begin
    ColStart:=Ptr;
 end;
 
+// CreateUTF8
+//
+constructor TdwsJSONParserState.CreateUTF8(aText : PAnsiChar; aLength : Integer);
+begin
+   UTF8Start:=aText;
+   UTF8Ptr:=aText;
+   UTF8ColStart:=aText;
+   UTF8End:=aText+aLength;
+end;
+
 // NeedChar
 //
 function TdwsJSONParserState.NeedChar : WideChar;
 var
    p : PWideChar;
 begin
+   if UTF8Ptr<>nil then
+      Exit(NeedUTF8Char);
    p:=Ptr;
    Inc(Ptr);
    if p^=#10 then begin
@@ -435,11 +456,34 @@ begin
    Result:=p^;
 end;
 
+// NeedUTF8Char
+//
+// structural characters are all ASCII, so bytes are handed out as they are,
+// multi-byte sequences only get decoded inside strings
+function TdwsJSONParserState.NeedUTF8Char : WideChar;
+var
+   p : PAnsiChar;
+begin
+   p:=UTF8Ptr;
+   if p>=UTF8End then
+      Exit(#0);
+   Inc(UTF8Ptr);
+   if p^=#10 then begin
+      UTF8ColStart:=p;
+      Inc(Line);
+   end;
+   Result:=WideChar(Ord(p^));
+end;
+
 // Location
 //
 function TdwsJSONParserState.Location : UnicodeString;
 begin
-   if (Line=0) then begin
+   if UTF8Ptr<>nil then begin
+      Result:=Format('line %d, col %d (byte offset %d)',
+                     [Line+1, NativeInt(UTF8Ptr)-NativeInt(UTF8ColStart),
+                      NativeInt(UTF8Ptr)-NativeInt(UTF8Start)]);
+   end else if (Line=0) then begin
       Result:=Format('line 1, col %d',
                      [(NativeInt(Ptr)-NativeInt(ColStart)) div SizeOf(WideChar)]);
    end else begin
@@ -475,6 +519,10 @@ var
    localBufferPtr, startPr : PWideChar;
    localBuffer : array [0..59] of WideChar; // range adjusted to have a stack space of 128 for the proc
 begin
+   if UTF8Ptr<>nil then begin
+      ParseUTF8JSONString(result);
+      Exit;
+   end;
    startPr:=Ptr;
    wobs:=nil;
    try
@@ -547,6 +595,99 @@ begin
    end;
 end;
 
+// ParseUTF8JSONString
+//
+procedure TdwsJSONParserState.ParseUTF8JSONString(var result : UnicodeString);
+var
+   p, stop : PAnsiChar;
+   dest : PWideChar;
+   c, extra, least : Cardinal;
+   hexCount : Integer;
+begin
+   // find the closing quote first, the UTF-16 result is never longer than the UTF-8 bytes
+   stop:=UTF8Ptr;
+   while (stop<UTF8End) and (stop^<>'"') do begin
+      if stop^='\' then
+         Inc(stop);
+      Inc(stop);
+   end;
+   if stop>=UTF8End then
+      TdwsJSONValue.RaiseJSONParseError('Unterminated string');
+
+   SetLength(result, stop-UTF8Ptr);
+   dest:=PWideChar(Pointer(result));
+   p:=UTF8Ptr;
+   while p<stop do begin
+      c:=Ord(p^);
+      Inc(p);
+      case c of
+         0..31 :
+            TdwsJSONValue.RaiseJSONParseError('Invalid string character %s', WideChar(c));
+         Ord('\') : begin
+            c:=Ord(p^);
+            Inc(p);
+            case AnsiChar(c) of
+               '"', '\', '/' : ;
+               'n' : c:=10;
+               'r' : c:=13;
+               't' : c:=9;
+               'b' : c:=8;
+               'f' : c:=12;
+               'u' : begin
+                  c:=0;
+                  for hexCount:=1 to 4 do begin
+                     case p^ of
+                        '0'..'9' :
+                           c:=(c shl 4)+Ord(p^)-Ord('0');
+                        'a'..'f' :
+                           c:=(c shl 4)+Ord(p^)-(Ord('a')-10);
+                        'A'..'F' :
+                           c:=(c shl 4)+Ord(p^)-(Ord('A')-10);
+                     else
+                        TdwsJSONValue.RaiseJSONParseError('Invalid unicode hex character "%s"', WideChar(Ord(p^)));
+                     end;
+                     Inc(p);
+                  end;
+               end;
+            else
+               TdwsJSONValue.RaiseJSONParseError('Invalid character "%s" after escape', WideChar(c));
+            end;
+         end;
+         $80..$FF : begin
+            case c of
+               $C2..$DF : begin extra:=1; c:=c and $1F; least:=$80; end;
+               $E0..$EF : begin extra:=2; c:=c and $0F; least:=$800; end;
+               $F0..$F4 : begin extra:=3; c:=c and $07; least:=$10000; end;
+            else
+               TdwsJSONValue.RaiseJSONParseError('Invalid UTF-8 lead byte %s', WideChar(c));
+               extra:=0;
+               least:=0;
+            end;
+            while extra>0 do begin
+               if (p>=stop) or ((Ord(p^) and $C0)<>$80) then
+                  TdwsJSONValue.RaiseJSONParseError('Invalid UTF-8 continuation byte %s', WideChar(Ord(p^)));
+               c:=(c shl 6) or (Ord(p^) and $3F);
+               Inc(p);
+               Dec(extra);
+            end;
+            // overlong forms (E0 80..9F, F0 80..8F), encoded surrogates (ED A0..BF) and beyond U+10FFFF (F4 90..) are not UTF-8
+            if (c<least) or (c>$10FFFF) or ((c>=$D800) and (c<=$DFFF)) then
+               TdwsJSONValue.RaiseJSONParseError('Invalid UTF-8 sequence (overlong, surrogate or beyond U+10FFFF)');
+            if c>$FFFF then begin
+               Dec(c, $10000);
+               dest^:=WideChar($D800+(c shr 10));
+               Inc(dest);
+               c:=$DC00+(c and $3FF);
+            end;
+         end;
+      end;
+      dest^:=WideChar(c);
+      Inc(dest);
+   end;
+   SetLength(result, dest-PWideChar(Pointer(result)));
+   UTF8Ptr:=stop+1;
+end;
+
 // ParseJSONNumber
 //
 procedure TdwsJSONParserState.ParseHugeJSONNumber(
@@ -868,6 +1009,31 @@ begin
    end;
 end;
 
+// ParseUTF8
+//
+class function TdwsJSONValue.ParseUTF8(text : PAnsiChar; length : Integer;
+                                       duplicatesOption : TdwsJSONDuplicatesOptions = jdoOverwrite) : TdwsJSONValue;
+var
+   parserState : TdwsJSONParserState;
+begin
+   Result:=nil;
+   parserState:=TdwsJSONParserState.CreateUTF8(text, length);
+   try
+      try
+         parserState.DuplicatesOption:=duplicatesOption;
+         Result:=TdwsJSONValue.Parse(parserState);
+      except
+         on e : EdwsJSONParseError do
+            raise EdwsJSONParseError.CreateFmt('%s, at %s',
+                                               [e.Message, parserState.Location]);
+      else
+         raise;
+      end;
+   finally
+      parserState.Free;
+   end;
+end;
+
 // ParseFile
 //
 class function TdwsJSONValue.ParseFile(const fileName : UnicodeString) : TdwsJSONValue;
@@ -928,6 +1094,25 @@ begin
    end;
 end;
 
+// ToUTF8String
+//
+function TdwsJSONValue.ToUTF8String : RawByteString;
+var
+   writer : TdwsJSONWriter;
+   wobs : TWriteOnlyBlockStream;
+begin
+   if Self=nil then Exit('');
+   wobs:=TWriteOnlyBlockStream.AllocFromPool;
+   writer:=TdwsJSONWriter.Create(wobs);
+   try
+      WriteTo(writer);
+      Result:=wobs.ToUTF8String;
+   finally
+      writer.Free;
+      wobs.ReturnToPool;
+   end;
+end;
+
 // ToString
 //
 function TdwsJSONValue.ToString : UnicodeString;
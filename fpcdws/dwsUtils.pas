@@ -18,6 +18,10 @@ unit dwsUtils;
 
 {$I dws.inc}
 
+{$if defined(CPUX86) or defined(CPUX64) or defined(CPUI386) or defined(CPUX86_64)}
+   {$define UNALIGNED_READS} // UTF-16 is encoded four characters at a time where unaligned reads are cheap
+{$ifend}
+
 interface
 
 uses
@@ -710,6 +714,10 @@ procedure BytesToScriptString(const p : PByte; n : Integer; var result : Unicode
 function ScriptStringToRawByteString(const s : UnicodeString) : RawByteString; overload; inline;
 procedure ScriptStringToRawByteString(const s : UnicodeString; var result : RawByteString); overload;
 
+// dest must have room for 3 bytes per WideChar, returns the bytes written, without a terminator
+function UTF16ToUTF8Buffer(source : PWideChar; count : Integer; dest : PAnsiChar) : Integer;
+function UTF16ToUTF8(const s : UnicodeString) : UTF8String;
+
 type
    TInt64StringBuffer = array [0..21] of WideChar;
    TInt32StringBuffer = array [0..11] of WideChar;
@@ -1218,6 +1226,72 @@ begin
       pDest[i]:=Word(PByte(@pSrc[i])^);
 end;
 
+// UTF16ToUTF8Buffer
+//
+// single pass, four ASCII characters at a time while there are any,
+// surrogate pairs become one 4 byte sequence, lone surrogates are encoded as they are
+function UTF16ToUTF8Buffer(source : PWideChar; count : Integer; dest : PAnsiChar) : Integer;
+var
+   stop : PWideChar;
+   start : PAnsiChar;
+   c : Cardinal;
+{$ifdef UNALIGNED_READS}
+   quad : Int64;
+{$endif}
+begin
+   start:=dest;
+   stop:=source+count;
+   while source<stop do begin
+{$ifdef UNALIGNED_READS}
+      while (stop-source>=4) and ((PInt64(source)^ and Int64($FF80FF80FF80FF80))=0) do begin
+         quad:=PInt64(source)^;
+         PCardinal(dest)^:= Cardinal(quad and $FF) or Cardinal((quad shr 8) and $FF00)
+                           or Cardinal((quad shr 16) and $FF0000) or Cardinal((quad shr 24) and $FF000000);
+         Inc(source, 4);
+         Inc(dest, 4);
+      end;
+      if source>=stop then Break;
+{$endif}
+      c:=Ord(source^);
+      Inc(source);
+      if c<$80 then begin
+         dest^:=AnsiChar(c);
+         Inc(dest);
+         continue;
+      end;
+      if (c>=$D800) and (c<=$DBFF) and (source<stop) and (Ord(source^)>=$DC00) and (Ord(source^)<=$DFFF) then begin
+         c:=$10000+((c-$D800) shl 10)+(Ord(source^)-$DC00);
+         Inc(source);
+      end;
+      if c<$800 then begin
+         dest[0]:=AnsiChar($C0 or (c shr 6));
+         dest[1]:=AnsiChar($80 or (c and $3F));
+         Inc(dest, 2);
+      end else if c<$10000 then begin
+         dest[0]:=AnsiChar($E0 or (c shr 12));
+         dest[1]:=AnsiChar($80 or ((c shr 6) and $3F));
+         dest[2]:=AnsiChar($80 or (c and $3F));
+         Inc(dest, 3);
+      end else begin
+         dest[0]:=AnsiChar($F0 or (c shr 18));
+         dest[1]:=AnsiChar($80 or ((c shr 12) and $3F));
+         dest[2]:=AnsiChar($80 or ((c shr 6) and $3F));
+         dest[3]:=AnsiChar($80 or (c and $3F));
+         Inc(dest, 4);
+      end;
+   end;
+   Result:=dest-start;
+end;
+
+// UTF16ToUTF8
+//
+function UTF16ToUTF8(const s : UnicodeString) : UTF8String;
+begin
+   if s='' then Exit('');
+   SetLength(Result, Length(s)*3);
+   SetLength(Result, UTF16ToUTF8Buffer(PWideChar(Pointer(s)), Length(s), PAnsiChar(Pointer(Result))));
+end;
+
 // ------------------
 // ------------------ TStringUnifier ------------------
 // ------------------
@@ -2561,9 +2635,9 @@ end;
 //
 procedure TWriteOnlyBlockStream.StoreUTF8Data(destStream : TStream);
 var
-   buf : UTF8String;
+   buf : RawByteString;
 begin
-   buf:=UTF8Encode(ToString);
+   buf:=ToUTF8String;
    if buf<>'' then
       destStream.Write(buf[1], Length(buf));
 end;
@@ -2800,8 +2874,17 @@ end;
 // ToUTF8String
 //
 function TWriteOnlyBlockStream.ToUTF8String : RawByteString;
+var
+   uniBuf : UnicodeString;
 begin
-   Result:=UTF8Encode(ToString);
+   if FTotalSize>0 then begin
+
+      Assert((FTotalSize and 1) = 0);
+      SetLength(uniBuf, FTotalSize div SizeOf(WideChar));
+      StoreData(uniBuf[1]);
+      Result:=UTF16ToUTF8(uniBuf);
+
+   end else Result:='';
 end;
 
 // ToBytes
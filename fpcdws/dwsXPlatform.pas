@@ -21,7 +21,9 @@ unit dwsXPlatform;
 
 {$I dws.inc}
 
-{$DEFINE WIN32_ASM}
+{$IFDEF WIN32}
+   {$DEFINE WIN32_ASM}
+{$ENDIF}
 
 //
 // This unit should concentrate all non-UI cross-platform aspects,
@@ -38,15 +40,13 @@ unit dwsXPlatform;
 interface
 
 uses
-   Classes, SysUtils, Types, Masks,
+   Classes, SysUtils, Types, Masks
    {$IFDEF FPC}
       {$IFDEF Windows}
-         Windows
-      {$ELSE}
-         LCLIntf
+         , Windows
       {$ENDIF}
    {$ELSE}
-      Windows
+      , Windows
       {$IFNDEF VER200}, IOUtils{$ENDIF}
    {$ENDIF}
    ;
@@ -59,7 +59,11 @@ const
 {$ENDIF}
 
    // following is missing from D2010
+{$IFDEF WINDOWS}
    INVALID_HANDLE_VALUE = DWORD(-1);
+{$ELSE}
+   INVALID_HANDLE_VALUE = THandle(-1);
+{$ENDIF}
 
 type
    // see http://delphitools.info/2011/11/30/fixing-tcriticalsection/
@@ -233,24 +237,37 @@ uses Variants;
 {$endif}
 
 {$ifdef FPC}
+{$IFDEF WINDOWS}
 type
    TFindExInfoLevels = FINDEX_INFO_LEVELS;
+{$ENDIF}
 {$endif}
 
 // GetSystemTimeMilliseconds
 //
 function GetSystemTimeMilliseconds : Int64; stdcall;
+{$IFDEF WINDOWS}
 var
    fileTime : TFileTime;
 begin
-{$IFDEF WINDOWS}
    GetSystemTimeAsFileTime(fileTime);
    Result:=Round(PInt64(@fileTime)^*1e-4); // 181
 {$ELSE}
-   Not yet implemented!
+begin
+   // wall clock, milliseconds since the Unix epoch
+   Result:=Round((LocalTimeToUniversal(Now)-UnixDateDelta)*MSecsPerDay);
 {$ENDIF}
 end;
 
+{$IFNDEF WINDOWS}
+// GetTickCountMilliseconds
+//
+function GetTickCountMilliseconds : Int64; stdcall;
+begin
+   Result:=GetTickCount64;
+end;
+{$ENDIF}
+
 // GetSystemMilliseconds
 //
 var
@@ -268,13 +285,16 @@ end;
 // InitializeGetSystemMilliseconds
 //
 procedure InitializeGetSystemMilliseconds;
+{$IFDEF WINDOWS}
 var
    h : THandle;
 begin
-   {$IFDEF WINDOWS}
    h:=LoadLibrary('kernel32.dll');
    vGetSystemMilliseconds:=GetProcAddress(h, 'GetTickCount64');
-   {$ENDIF}
+{$ELSE}
+begin
+   vGetSystemMilliseconds:=@GetTickCountMilliseconds;
+{$ENDIF}
    if not Assigned(vGetSystemMilliseconds) then
       vGetSystemMilliseconds:=@GetSystemTimeMilliseconds;
 end;
@@ -292,7 +312,7 @@ begin
       Result:= EncodeDate(wYear, wMonth, wDay)
               +EncodeTime(wHour, wMinute, wSecond, wMilliseconds);
 {$ELSE}
-   Not yet implemented!
+   Result:=LocalTimeToUniversal(Now);
 {$ENDIF}
 end;
 
@@ -339,19 +359,37 @@ end;
 // UnicodeComparePChars
 //
 function UnicodeComparePChars(p1 : PWideChar; n1 : Integer; p2 : PWideChar; n2 : Integer) : Integer;
+{$IFDEF WINDOWS}
 const
    CSTR_EQUAL = 2;
 begin
    Result:=CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORECASE, p1, n1, p2, n2)-CSTR_EQUAL;
+{$ELSE}
+var
+   s1, s2 : UnicodeString;
+begin
+   SetString(s1, p1, n1);
+   SetString(s2, p2, n2);
+   Result:=widestringmanager.CompareTextUnicodeStringProc(s1, s2);
+   if Result<0 then
+      Result:=-1
+   else if Result>0 then
+      Result:=1;
+{$ENDIF}
 end;
 
 // UnicodeComparePChars
 //
 function UnicodeComparePChars(p1, p2 : PWideChar; n : Integer) : Integer; overload;
+{$IFDEF WINDOWS}
 const
    CSTR_EQUAL = 2;
 begin
    Result:=CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORECASE, p1, n, p2, n)-CSTR_EQUAL;
+{$ELSE}
+begin
+   Result:=UnicodeComparePChars(p1, n, p2, n);
+{$ENDIF}
 end;
 
 // UnicodeLowerCase
@@ -359,9 +397,13 @@ end;
 function UnicodeLowerCase(const s : UnicodeString) : UnicodeString;
 begin
    if s<>'' then begin
+      {$IFDEF WINDOWS}
       Result:=s;
       UniqueString(Result);
       Windows.CharLowerBuffW(PWideChar(Pointer(Result)), Length(Result));
+      {$ELSE}
+      Result:=widestringmanager.LowerUnicodeStringProc(s);
+      {$ENDIF}
    end else Result:=s;
 end;
 
@@ -370,9 +412,13 @@ end;
 function UnicodeUpperCase(const s : UnicodeString) : UnicodeString;
 begin
    if s<>'' then begin
+      {$IFDEF WINDOWS}
       Result:=s;
       UniqueString(Result);
       Windows.CharUpperBuffW(PWideChar(Pointer(Result)), Length(Result));
+      {$ELSE}
+      Result:=widestringmanager.UpperUnicodeStringProc(s);
+      {$ENDIF}
    end else Result:=s;
 end;
 
@@ -403,7 +449,11 @@ end;
 function InterlockedIncrement(var val : Integer) : Integer;
 {$ifndef WIN32_ASM}
 begin
+   {$IFDEF WINDOWS}
    Result:=Windows.InterlockedIncrement(val);
+   {$ELSE}
+   Result:=System.InterlockedIncrement(val);
+   {$ENDIF}
 {$else}
 asm
    mov   ecx,  eax
@@ -418,7 +468,11 @@ end;
 function InterlockedDecrement(var val : Integer) : Integer;
 {$ifndef WIN32_ASM}
 begin
+   {$IFDEF WINDOWS}
    Result:=Windows.InterlockedDecrement(val);
+   {$ELSE}
+   Result:=System.InterlockedDecrement(val);
+   {$ENDIF}
 {$else}
 asm
    mov   ecx,  eax
@@ -458,7 +512,7 @@ function InterlockedExchangePointer(var target : Pointer; val : Pointer) : Point
 {$ifndef WIN32_ASM}
 begin
    {$ifdef FPC}
-   Result:=InterlockedExchangePointer(target, val);
+   Result:=System.InterlockedExchange(target, val);
    {$else}
    Result:=Windows.InterlockedExchangePointer(target, val);
    {$endif}
@@ -471,8 +525,11 @@ end;
 
 // SetThreadName
 //
+{$IFDEF WINDOWS}
 function IsDebuggerPresent : BOOL; stdcall; external kernel32 name 'IsDebuggerPresent';
+{$ENDIF}
 procedure SetThreadName(const threadName : PAnsiChar; threadID : Cardinal = Cardinal(-1));
+{$IFDEF WINDOWS}
 // http://www.codeproject.com/Articles/8549/Name-your-threads-in-the-VC-debugger-thread-list
 type
    TThreadNameInfo = record
@@ -496,19 +553,26 @@ begin
    except
    end;
    {$endif}
+{$ELSE}
+begin
+   // thread names are a debugger convention on Windows only
+{$ENDIF}
 end;
 
 // OutputDebugString
 //
 procedure OutputDebugString(const msg : UnicodeString);
 begin
+   {$IFDEF WINDOWS}
    Windows.OutputDebugStringW(PWideChar(msg));
+   {$ENDIF}
 end;
 
 // WriteToOSEventLog
 //
 procedure WriteToOSEventLog(const logName, logCaption, logDetails : UnicodeString;
                             const logRawData : RawByteString = '');
+{$IFDEF WINDOWS}
 var
   eventSource : THandle;
   detailsPtr : array [0..1] of PWideChar;
@@ -527,6 +591,10 @@ begin
          DeregisterEventSource(eventSource);
       end;
    end;
+{$ELSE}
+begin
+   // there is no event log outside of Windows, the host's own logging is used instead
+{$ENDIF}
 end;
 
 // SetDecimalSeparator
@@ -559,6 +627,7 @@ begin
    {$ENDIF}
 end;
 
+{$IFDEF WINDOWS}
 // CollectFiles
 //
 type
@@ -622,6 +691,38 @@ begin
       Windows.FindClose(searchRec.Handle);
    end;
 end;
+{$ELSE}
+// CollectFilesMasked
+//
+procedure CollectFilesMasked(const directory : UnicodeString;
+                             mask : TMask; list : TStrings;
+                             recurseSubdirectories: Boolean = False;
+                             onProgress : TCollectFileProgressEvent = nil);
+var
+   searchRec : TSearchRec;
+   shouldAbort : Boolean;
+begin
+   if Assigned(onProgress) then begin
+      shouldAbort:=False;
+      onProgress(directory, shouldAbort);
+      if shouldAbort then exit;
+   end;
+
+   if FindFirst(directory+'*', faAnyFile, searchRec)=0 then begin
+      try
+         repeat
+            if (searchRec.Attr and faDirectory)=0 then begin
+               if mask.Matches(searchRec.Name) then
+                  list.Add(directory+searchRec.Name);
+            end else if recurseSubdirectories and (searchRec.Name<>'.') and (searchRec.Name<>'..') then
+               CollectFilesMasked(directory+searchRec.Name+PathDelim, mask, list, True, onProgress);
+         until FindNext(searchRec)<>0;
+      finally
+         FindClose(searchRec);
+      end;
+   end;
+end;
+{$ENDIF}
 
 // CollectFiles
 //
@@ -710,6 +811,7 @@ end;
 // LoadTextFromFile
 //
 function LoadTextFromFile(const fileName : UnicodeString) : UnicodeString;
+{$IFDEF WINDOWS}
 const
    INVALID_FILE_SIZE = DWORD($FFFFFFFF);
 var
@@ -733,6 +835,29 @@ begin
    finally
       FileClose(hFile);
    end;
+{$ELSE}
+var
+   hFile : THandle;
+   n : Int64;
+   buf : TBytes;
+begin
+   hFile:=OpenFileForSequentialReadOnly(fileName);
+   if hFile=INVALID_HANDLE_VALUE then
+      Exit('');
+   try
+      n:=FileSeek(hFile, Int64(0), fsFromEnd);
+      if (n<0) or (FileSeek(hFile, Int64(0), fsFromBeginning)<>0) then
+         RaiseLastOSError;
+      if n>0 then begin
+         SetLength(buf, n);
+         if FileRead(hFile, buf[0], n)<>n then
+            RaiseLastOSError;
+         Result:=LoadTextFromBuffer(buf);
+      end else Result:='';
+   finally
+      FileClose(hFile);
+   end;
+{$ENDIF}
 end;
 
 // SaveTextToUTF8File
@@ -747,7 +872,11 @@ begin
    hFile:=OpenFileForSequentialWriteOnly(fileName);
    try
       if utf8<>'' then
+         {$IFDEF WINDOWS}
          if not WriteFile(hFile, utf8[1], Length(utf8), nWrite, nil) then
+         {$ELSE}
+         if FileWrite(hFile, utf8[1], Length(utf8))<>Length(utf8) then
+         {$ENDIF}
             RaiseLastOSError;
    finally
       FileClose(hFile);
@@ -758,20 +887,32 @@ end;
 //
 function OpenFileForSequentialReadOnly(const fileName : UnicodeString) : THandle;
 begin
+   {$IFDEF WINDOWS}
    Result:=CreateFileW(PWideChar(fileName), GENERIC_READ, FILE_SHARE_READ+FILE_SHARE_WRITE,
                        nil, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
    if Result=INVALID_HANDLE_VALUE then begin
       if GetLastError<>ERROR_FILE_NOT_FOUND then
          RaiseLastOSError;
    end;
+   {$ELSE}
+   Result:=FileOpen(UTF8Encode(fileName), fmOpenRead or fmShareDenyNone);
+   if Result=INVALID_HANDLE_VALUE then begin
+      if FileExists(UTF8Encode(fileName)) then
+         RaiseLastOSError;
+   end;
+   {$ENDIF}
 end;
 
 // OpenFileForSequentialWriteOnly
 //
 function OpenFileForSequentialWriteOnly(const fileName : UnicodeString) : THandle;
 begin
+   {$IFDEF WINDOWS}
    Result:=CreateFileW(PWideChar(fileName), GENERIC_WRITE, 0, nil, CREATE_ALWAYS,
                        FILE_ATTRIBUTE_NORMAL+FILE_FLAG_SEQUENTIAL_SCAN, 0);
+   {$ELSE}
+   Result:=FileCreate(UTF8Encode(fileName));
+   {$ENDIF}
    if Result=INVALID_HANDLE_VALUE then
       RaiseLastOSError;
 end;
@@ -780,14 +921,42 @@ end;
 //
 procedure CloseFileHandle(hFile : THandle);
 begin
+   {$IFDEF WINDOWS}
    CloseHandle(hFile);
+   {$ELSE}
+   FileClose(hFile);
+   {$ENDIF}
 end;
 
 // FileCopy
 //
 function FileCopy(const existing, new : UnicodeString; failIfExists : Boolean) : Boolean;
+{$IFDEF WINDOWS}
 begin
    Result:=Windows.CopyFileW(PWideChar(existing), PWideChar(new), failIfExists);
+{$ELSE}
+var
+   source, dest : TFileStream;
+begin
+   Result:=False;
+   if failIfExists and FileExists(UTF8Encode(new)) then Exit;
+   try
+      source:=TFileStream.Create(UTF8Encode(existing), fmOpenRead or fmShareDenyWrite);
+      try
+         dest:=TFileStream.Create(UTF8Encode(new), fmCreate);
+         try
+            dest.CopyFrom(source, 0);
+         finally
+            dest.Free;
+         end;
+      finally
+         source.Free;
+      end;
+      Result:=True;
+   except
+      on EStreamError do ;
+   end;
+{$ENDIF}
 end;
 
 // FileDelete
@@ -807,17 +976,28 @@ end;
 // FileSize
 //
 function FileSize(const name : String) : Int64;
+{$IFDEF WINDOWS}
 var
    info : TWin32FileAttributeData;
 begin
    if GetFileAttributesEx(PChar(Pointer(name)), GetFileExInfoStandard, @info) then
       Result:=info.nFileSizeLow or (Int64(info.nFileSizeHigh) shl 32)
    else Result:=-1;
+{$ELSE}
+var
+   searchRec : TSearchRec;
+begin
+   if FindFirst(name, faAnyFile, searchRec)=0 then begin
+      Result:=searchRec.Size;
+      FindClose(searchRec);
+   end else Result:=-1;
+{$ENDIF}
 end;
 
 // FileDateTime
 //
 function FileDateTime(const name : String) : TDateTime;
+{$IFDEF WINDOWS}
 var
    info : TWin32FileAttributeData;
    systemTime : TSystemTime;
@@ -826,6 +1006,11 @@ begin
       FileTimeToSystemTime(info.ftLastWriteTime, systemTime);
       Result:=SystemTimeToDateTime(systemTime);
    end else Result:=0;
+{$ELSE}
+begin
+   if not FileAge(name, Result) then
+      Result:=0;
+{$ENDIF}
 end;
 
 // DirectSet8087CW
@@ -910,14 +1095,22 @@ end;
 //
 constructor TFixedCriticalSection.Create;
 begin
+   {$IFDEF WINDOWS}
    InitializeCriticalSection(FCS);
+   {$ELSE}
+   InitCriticalSection(FCS);
+   {$ENDIF}
 end;
 
 // Destroy
 //
 destructor TFixedCriticalSection.Destroy;
 begin
+   {$IFDEF WINDOWS}
    DeleteCriticalSection(FCS);
+   {$ELSE}
+   DoneCriticalSection(FCS);
+   {$ENDIF}
 end;
 
 // Enter
@@ -938,7 +1131,11 @@ end;
 //
 function TFixedCriticalSection.TryEnter : Boolean;
 begin
+   {$IFDEF WINDOWS}
    Result:=TryEnterCriticalSection(FCS);
+   {$ELSE}
+   Result:=(TryEnterCriticalSection(FCS)<>0);
+   {$ENDIF}
 end;
 
 // ------------------
@@ -948,7 +1145,10 @@ end;
 // GetTempFileName
 //
 class function TPath.GetTempFileName : UnicodeString;
-{$IFDEF VER200} // Delphi 2009
+{$IF Defined(FPC) and not Defined(WINDOWS)}
+begin
+   Result:=UTF8Decode(SysUtils.GetTempFileName);
+{$ELSEIF Defined(VER200)} // Delphi 2009
 var
    tempPath, tempFileName : array [0..MAX_PATH] of WideChar; // Buf sizes are MAX_PATH+1
 begin
@@ -962,7 +1162,7 @@ begin
 {$ELSE}
 begin
    Result:=IOUTils.TPath.GetTempFileName;
-{$ENDIF}
+{$IFEND}
 end;
 
 // ------------------
@@ -1024,6 +1224,12 @@ var AcquireSRWLockShared : procedure(var SRWLock : SRWLOCK); stdcall;
 var ReleaseSRWLockShared : procedure (var SRWLock : SRWLOCK); stdcall;
 
 function SupportsSRW : Boolean;
+{$IFNDEF WINDOWS}
+begin
+   // slim reader/writer locks are a Windows API, elsewhere the critical section fallback is used
+   Result:=False;
+end;
+{$ELSE}
 var
    h : HMODULE;
 begin
@@ -1037,6 +1243,7 @@ begin
    end;
    Result:=Assigned(AcquireSRWLockExclusive);
 end;
+{$ENDIF}
 
 // Create
 //